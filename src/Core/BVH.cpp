@@ -0,0 +1,201 @@
+#include "Core/BVH.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace FS
+{
+
+    void BVH::clear()
+    {
+        m_nodes.clear();
+        m_primitives.clear();
+    }
+
+    void BVH::build(const std::vector<Box>& boxes, int leaf_size)
+    {
+        clear();
+        const int n = static_cast<int>(boxes.size());
+        if (n == 0)
+            return;
+        m_primitives.resize(n);
+        std::vector<Vector3s> centers(n);
+#pragma omp parallel for
+        for (int i = 0; i < n; ++i)
+        {
+            m_primitives[i] = i;
+            centers[i]      = boxes[i].center();
+        }
+        m_nodes.reserve(2 * (n / std::max(1, leaf_size)) + 1);
+
+        // Top-down median split along the widest axis of the centers; splitting by count keeps the depth at log2(n)
+        struct Task
+        {
+            int node;
+            int begin;
+            int end;
+        };
+        std::vector<Task> tasks;
+        m_nodes.emplace_back();
+        tasks.push_back({0, 0, n});
+        while (!tasks.empty())
+        {
+            Task task = tasks.back();
+            tasks.pop_back();
+            Node& node = m_nodes[task.node];
+            node.begin = task.begin;
+            node.end   = task.end;
+            if (task.end - task.begin <= leaf_size)
+                continue;
+
+            Box center_box;
+            for (int k = task.begin; k < task.end; ++k)
+                center_box.extend(centers[m_primitives[k]]);
+            int axis;
+            center_box.sizes().maxCoeff(&axis);
+            int mid = (task.begin + task.end) / 2;
+            std::nth_element(m_primitives.begin() + task.begin,
+                             m_primitives.begin() + mid,
+                             m_primitives.begin() + task.end,
+                             [&](int a, int b) { return centers[a](axis) < centers[b](axis); });
+
+            int left  = static_cast<int>(m_nodes.size());
+            int right = left + 1;
+            m_nodes.emplace_back();
+            m_nodes.emplace_back();
+            m_nodes[task.node].left  = left;
+            m_nodes[task.node].right = right;
+            tasks.push_back({right, mid, task.end});
+            tasks.push_back({left, task.begin, mid});
+        }
+        refit(boxes);
+    }
+
+    void BVH::refit(const std::vector<Box>& boxes)
+    {
+        const int num_nodes = static_cast<int>(m_nodes.size());
+#pragma omp parallel for schedule(dynamic, 256)
+        for (int i = 0; i < num_nodes; ++i)
+        {
+            Node& node = m_nodes[i];
+            if (!node.isLeaf())
+                continue;
+            node.box.setEmpty();
+            for (int k = node.begin; k < node.end; ++k)
+                node.box.extend(boxes[m_primitives[k]]);
+        }
+        // Children are stored after their parent, so a reverse sweep sees them first
+        for (int i = num_nodes - 1; i >= 0; --i)
+        {
+            Node& node = m_nodes[i];
+            if (!node.isLeaf())
+                node.box = m_nodes[node.left].box.merged(m_nodes[node.right].box);
+        }
+    }
+
+    void TriangleBoxes(const VertexBufferS& V, const Eigen::MatrixXi& F, std::vector<BVH::Box>& boxes, Scalar margin)
+    {
+        const int num_faces = static_cast<int>(F.rows());
+        boxes.resize(num_faces);
+#pragma omp parallel for
+        for (int f = 0; f < num_faces; ++f)
+        {
+            BVH::Box box;
+            for (int c = 0; c < 3; ++c)
+                box.extend(V.row(F(f, c)).transpose());
+            boxes[f] = BVH::Box(box.min().array() - margin, box.max().array() + margin);
+        }
+    }
+
+    // Slab test, returns the entry distance or +inf on a miss
+    static Scalar RayBoxEntry(const BVH::Box& box, const Vector3s& origin, const Vector3s& inv_dir, Scalar t_max)
+    {
+        Vector3s t0    = (box.min() - origin).cwiseProduct(inv_dir);
+        Vector3s t1    = (box.max() - origin).cwiseProduct(inv_dir);
+        Scalar   enter = std::max(t0.cwiseMin(t1).maxCoeff(), Scalar(0));
+        Scalar   exit  = std::min(t0.cwiseMax(t1).minCoeff(), t_max);
+        return enter <= exit ? enter : std::numeric_limits<Scalar>::infinity();
+    }
+
+    bool IntersectRay(const BVH&             bvh,
+                      const VertexBufferS&   V,
+                      const Eigen::MatrixXi& F,
+                      const Vector3s&        origin,
+                      const Vector3s&        dir,
+                      RayHit&                hit)
+    {
+        if (bvh.empty())
+            return false;
+        const Scalar inf = std::numeric_limits<Scalar>::infinity();
+        // Avoid 0 * inf in the slab test for axis aligned rays
+        Vector3s inv_dir = dir.unaryExpr([](Scalar d) { return std::abs(d) < Scalar(1e-20) ? Scalar(1e20) : Scalar(1) / d; });
+        hit.face         = -1;
+        hit.t            = inf;
+
+        // Front-to-back traversal, nodes farther than the current hit are skipped
+        std::pair<int, Scalar> stack[64];
+        int                    top = 0;
+        Scalar                 t0  = RayBoxEntry(bvh.m_nodes[0].box, origin, inv_dir, hit.t);
+        if (t0 < inf)
+            stack[top++] = {0, t0};
+        while (top > 0)
+        {
+            auto [index, t_enter] = stack[--top];
+            if (t_enter > hit.t)
+                continue;
+            const BVH::Node& node = bvh.m_nodes[index];
+            if (node.isLeaf())
+            {
+                for (int k = node.begin; k < node.end; ++k)
+                {
+                    // Moller-Trumbore
+                    int      f   = bvh.m_primitives[k];
+                    Vector3s a   = V.row(F(f, 0)).transpose();
+                    Vector3s e1  = V.row(F(f, 1)).transpose() - a;
+                    Vector3s e2  = V.row(F(f, 2)).transpose() - a;
+                    Vector3s p   = dir.cross(e2);
+                    Scalar   det = e1.dot(p);
+                    if (std::abs(det) < std::numeric_limits<Scalar>::min())
+                        continue;
+                    Scalar   inv_det = Scalar(1) / det;
+                    Vector3s s       = origin - a;
+                    Scalar   u       = s.dot(p) * inv_det;
+                    if (u < 0 || u > 1)
+                        continue;
+                    Vector3s q = s.cross(e1);
+                    Scalar   v = dir.dot(q) * inv_det;
+                    if (v < 0 || u + v > 1)
+                        continue;
+                    Scalar t = e2.dot(q) * inv_det;
+                    if (t >= 0 && t < hit.t)
+                    {
+                        hit.t    = t;
+                        hit.face = f;
+                        hit.bary = Vector3s(1 - u - v, u, v);
+                    }
+                }
+                continue;
+            }
+            Scalar tl = RayBoxEntry(bvh.m_nodes[node.left].box, origin, inv_dir, hit.t);
+            Scalar tr = RayBoxEntry(bvh.m_nodes[node.right].box, origin, inv_dir, hit.t);
+            // Push the farther child first so the nearer one is popped next
+            if (tl > tr)
+            {
+                std::swap(tl, tr);
+                if (tr < inf)
+                    stack[top++] = {node.left, tr};
+                if (tl < inf)
+                    stack[top++] = {node.right, tl};
+            }
+            else
+            {
+                if (tr < inf)
+                    stack[top++] = {node.right, tr};
+                if (tl < inf)
+                    stack[top++] = {node.left, tl};
+            }
+        }
+        return hit.face >= 0;
+    }
+
+} // namespace FS
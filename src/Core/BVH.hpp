@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Core/Scalar.hpp"
+#include "Core/VertexBuffer.hpp"
+
+#include <Eigen/Geometry>
+
+#include <vector>
+
+namespace FS
+{
+
+    // Bounding volume hierarchy over primitives given by their boxes (triangles, tets, ...).
+    // `build` sorts primitives once; when they move without changing connectivity `refit` only
+    // recomputes the node boxes bottom-up, which is much cheaper than a rebuild.
+    struct BVH
+    {
+        using Box = Eigen::AlignedBox<Scalar, 3>;
+
+        struct Node
+        {
+            Box box;
+            int left  = -1; // child node indices, -1 for leaves
+            int right = -1;
+            int begin = 0;  // primitive range in `m_primitives`
+            int end   = 0;
+
+            bool isLeaf() const { return left < 0; }
+        };
+
+        std::vector<Node> m_nodes;      // depth first order, children always after their parent
+        std::vector<int>  m_primitives; // primitive ids sorted by leaf
+
+        void build(const std::vector<Box>& boxes, int leaf_size = 4);
+        void refit(const std::vector<Box>& boxes);
+        void clear();
+
+        bool empty() const { return m_nodes.empty(); }
+
+        // Visits every primitive whose leaf box passes `node_test`: node_test(box) -> bool, on_primitive(id).
+        template<typename NodeTest, typename OnPrimitive>
+        void traverse(NodeTest&& node_test, OnPrimitive&& on_primitive) const
+        {
+            if (m_nodes.empty())
+                return;
+            int stack[64];
+            int top      = 0;
+            stack[top++] = 0;
+            while (top > 0)
+            {
+                const Node& node = m_nodes[stack[--top]];
+                if (!node_test(node.box))
+                    continue;
+                if (node.isLeaf())
+                {
+                    for (int k = node.begin; k < node.end; ++k)
+                        on_primitive(m_primitives[k]);
+                }
+                else
+                {
+                    stack[top++] = node.right;
+                    stack[top++] = node.left;
+                }
+            }
+        }
+    };
+
+    // Boxes of the triangles of a surface mesh, optionally inflated by `margin`
+    void TriangleBoxes(const VertexBufferS& V, const Eigen::MatrixXi& F, std::vector<BVH::Box>& boxes, Scalar margin = 0);
+
+    struct RayHit
+    {
+        int      face = -1;
+        Scalar   t    = 0;
+        Vector3s bary = Vector3s::Zero(); // weights of F(face, 0..2)
+    };
+
+    // Closest ray-triangle intersection, `dir` need not be normalized
+    bool IntersectRay(const BVH&             bvh,
+                      const VertexBufferS&   V,
+                      const Eigen::MatrixXi& F,
+                      const Vector3s&        origin,
+                      const Vector3s&        dir,
+                      RayHit&                hit);
+
+} // namespace FS
@@ -0,0 +1,125 @@
+#include "Core/Embedding.hpp"
+
+#include "Core/BVH.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <limits>
+
+namespace FS
+{
+
+    // Barycentric weights of p in tet t; all non-negative when p is inside
+    static Eigen::Matrix<Scalar, 4, 1> TetBarycentric(const MatrixXs& TV, const Eigen::MatrixXi& TT, int t, const Vector3s& p)
+    {
+        Vector3s x0 = TV.row(TT(t, 0)).transpose();
+        Matrix3s D;
+        for (int c = 0; c < 3; ++c)
+            D.col(c) = TV.row(TT(t, c + 1)).transpose() - x0;
+        Vector3s                    b = D.partialPivLu().solve(p - x0);
+        Eigen::Matrix<Scalar, 4, 1> w;
+        w << 1 - b.sum(), b;
+        return w;
+    }
+
+    void Embedding::build(const VertexBufferS& V, const MatrixXs& TV, const Eigen::MatrixXi& TT)
+    {
+        const int n        = static_cast<int>(V.rows());
+        const int num_tets = static_cast<int>(TT.rows());
+        m_indices.resize(n, 4);
+        m_weights.resize(n, 4);
+        if (num_tets == 0)
+            return;
+
+        std::vector<BVH::Box> boxes(num_tets);
+#pragma omp parallel for
+        for (int t = 0; t < num_tets; ++t)
+        {
+            BVH::Box box;
+            for (int c = 0; c < 4; ++c)
+                box.extend(TV.row(TT(t, c)).transpose());
+            boxes[t] = box;
+        }
+        BVH bvh;
+        bvh.build(boxes);
+
+        // Search radius for vertices slightly outside the tet mesh (e.g. carved or coarser volumes)
+        const Scalar margin      = Scalar(0.02) * (TV.colwise().maxCoeff() - TV.colwise().minCoeff()).norm();
+        int          num_outside = 0;
+        int          num_snapped = 0;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+ : num_outside, num_snapped)
+        for (int i = 0; i < n; ++i)
+        {
+            const Vector3s              p         = V.row(i).transpose();
+            int                         best_tet  = -1;
+            Scalar                      best_min  = -std::numeric_limits<Scalar>::infinity();
+            Eigen::Matrix<Scalar, 4, 1> best_w    = Eigen::Matrix<Scalar, 4, 1>::Zero();
+            auto                        candidate = [&](int t) {
+                // Degenerate (flat) tets give non-finite weights
+                Eigen::Matrix<Scalar, 4, 1> w = TetBarycentric(TV, TT, t, p);
+                if (w.allFinite() && w.minCoeff() > best_min)
+                {
+                    best_min = w.minCoeff();
+                    best_tet = t;
+                    best_w   = w;
+                }
+            };
+            // Containing tet first, then the least outside tet within the margin, then all tets
+            bvh.traverse([&](const BVH::Box& box) { return box.exteriorDistance(p) <= 0; }, candidate);
+            if (best_min < -Scalar(1e-4))
+            {
+                num_outside++;
+                bvh.traverse([&](const BVH::Box& box) { return box.exteriorDistance(p) <= margin; }, candidate);
+                if (best_tet < 0)
+                {
+                    for (int t = 0; t < num_tets; ++t)
+                        candidate(t);
+                }
+            }
+            if (best_tet < 0)
+            {
+                // No tet gives finite weights: follow the nearest tet vertex rigidly
+                num_snapped++;
+                int    nearest      = 0;
+                Scalar nearest_dist = std::numeric_limits<Scalar>::infinity();
+                for (int v = 0; v < TV.rows(); ++v)
+                {
+                    const Scalar dist = (TV.row(v).transpose() - p).squaredNorm();
+                    if (dist < nearest_dist)
+                    {
+                        nearest      = v;
+                        nearest_dist = dist;
+                    }
+                }
+                m_indices.row(i).setConstant(nearest);
+                m_weights.row(i) << 1, 0, 0, 0;
+                continue;
+            }
+            m_indices.row(i) = TT.row(best_tet);
+            m_weights.row(i) = best_w.transpose();
+        }
+        if (num_outside > 0)
+            spdlog::warn("Embedding: {} of {} surface vertices are outside the tet mesh", num_outside, n);
+        if (num_snapped > 0)
+            spdlog::warn("Embedding: {} surface vertices have no valid tet and follow the nearest tet vertex", num_snapped);
+    }
+
+    void Embedding::apply(const MatrixXs& TV, VertexBufferS& V) const
+    {
+        V.parallelForEachVertex([&](Eigen::Index i, Scalar& x, Scalar& y, Scalar& z) {
+            Scalar px = 0, py = 0, pz = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                const int    c = m_indices(i, k);
+                const Scalar w = m_weights(i, k);
+                px += w * TV(c, 0);
+                py += w * TV(c, 1);
+                pz += w * TV(c, 2);
+            }
+            x = px;
+            y = py;
+            z = pz;
+        });
+    }
+
+} // namespace FS
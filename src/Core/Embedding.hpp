@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Core/Scalar.hpp"
+#include "Core/VertexBuffer.hpp"
+
+#include <Eigen/Core>
+
+namespace FS
+{
+
+    // Embeds the render surface in a tet mesh: every surface vertex follows the tet that contains it at rest
+    // with fixed barycentric weights, so the render resolution is independent of the simulation resolution.
+    // Vertices outside the tet mesh use the tet they are least outside of, with extrapolating weights; a vertex
+    // without any tet of finite weights (degenerate tets, non-finite positions) follows the nearest tet vertex.
+    struct Embedding
+    {
+        using Indices4 = Eigen::Matrix<int, Eigen::Dynamic, 4, Eigen::RowMajor>;
+        using Weights4 = Eigen::Matrix<Scalar, Eigen::Dynamic, 4, Eigen::RowMajor>;
+
+        Indices4 m_indices; // tet corners per surface vertex
+        Weights4 m_weights; // barycentric weights per surface vertex, summing to 1
+
+        void build(const VertexBufferS& V, const MatrixXs& TV, const Eigen::MatrixXi& TT);
+        // V_i = sum_k w_ik * TV(c_ik), parallel over the vertex blocks of V
+        void apply(const MatrixXs& TV, VertexBufferS& V) const;
+
+        Eigen::Index rows() const { return m_indices.rows(); }
+        // Tet vertex with the largest weight of surface vertex `v`, e.g. to pin or drag the volume under a pick
+        int dominantTetVertex(int v) const
+        {
+            int k;
+            m_weights.row(v).maxCoeff(&k);
+            return m_indices(v, k);
+        }
+    };
+
+} // namespace FS
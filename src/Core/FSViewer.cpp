@@ -1,12 +1,23 @@
 #include "FSViewer.hpp"
 
-#include <igl/stb/write_image.h>
-#include <igl/unproject_onto_mesh.h>
+#include "Util/ChromeTrace.hpp"
+
+#include <glad/glad.h>
+
+#include <filesystem>
+#include <igl/project.h>
+#include <igl/unproject.h>
 #include <imgui_internal.h>
 
 namespace FS
 {
 
+    // libigl keeps double positions in `ViewerData`, so the vertex buffer is widened once here on upload.
+    static void SetViewerMesh(igl::opengl::ViewerData& data, const VertexBufferS& V, const Eigen::MatrixXi& F)
+    {
+        data.set_mesh(V.toMatrix<double>(), F);
+    }
+
     // override for `igl::opengl::glfw::ViewerPlugin` init
     void FSViewer::init(igl::opengl::glfw::Viewer* _viewer)
     {
@@ -21,12 +32,39 @@ namespace FS
             spdlog::info(">>> Window m_sceneWindowSize = ({}, {})", m_sceneWindowSize.first, m_sceneWindowSize.second);
             m_frameBuffer->createBuffers(m_sceneWindowSize.first, m_sceneWindowSize.second);
         }
+
+        m_frameCapture = std::make_unique<FrameCapture>();
+        m_frameCapture->init();
+    }
+
+    // ======================================== Simulation ========================================
+    void FSViewer::Setup()
+    {
+        m_simulator.Setup(m_V, m_F);
+    }
+
+    void FSViewer::Step()
+    {
+        m_simulator.Step(m_V);
+        MarkMeshDirty(MESH_DIRTY_POSITION);
+    }
+
+    void FSViewer::Reset()
+    {
+        m_simulator.Reset(m_V);
+        MarkMeshDirty(MESH_DIRTY_POSITION);
     }
 
     // Render full frame
     bool FSViewer::pre_draw()
     {
         PROFILE("FRAME");
+        if (viewer->core().is_animating || m_isSingleStep)
+        {
+            PROFILE("SIMULATE");
+            Step();
+            m_isSingleStep = false;
+        }
         {
             PROFILE("PRE_DRAW");
             { // imgui context
@@ -35,13 +73,7 @@ namespace FS
             }
 
             { // update mesh data
-                viewer->data().set_mesh(m_V, m_F);
-                if (m_clickVert >= 0)
-                {
-                    auto c                    = Eigen::RowVector3d(0, 1, 0);
-                    viewer->data().point_size = 20.f;
-                    viewer->data().set_points(m_V.row(m_clickVert), c);
-                }
+                UploadMesh();
             }
         }
 
@@ -60,6 +92,11 @@ namespace FS
             }
         }
 
+        { // read back the scene framebuffer while it is still bound
+            PROFILE("CAPTURE");
+            CaptureFrame();
+        }
+
         {
             PROFILE("POST_DRAW");
             m_frameBuffer->unbind();
@@ -104,53 +141,228 @@ namespace FS
         return true;
     }
 
-    // ======================================== Export data ========================================
-    void FSViewer::ExportPNG(std::string url) // Screenshot
+    // ======================================== Mesh upload ========================================
+    // Unchanged frames upload nothing. A topology change goes through `set_mesh` once, which validates
+    // the mesh and rebuilds every buffer; a deformation only streams positions and normals.
+    void FSViewer::UploadMesh()
     {
-        double scale = 1.0;
-        viewer->data().point_size *= scale;
+        auto& data = viewer->data();
+        if (m_meshDirty & MESH_DIRTY_TOPOLOGY)
+        {
+            SetViewerMesh(data, m_V, m_F);
+
+            // Vertex -> face adjacency for the incremental normal update
+            m_vertexFaceOffsets.assign(m_V.rows() + 1, 0);
+            for (int f = 0; f < m_F.rows(); ++f)
+                for (int c = 0; c < 3; ++c)
+                    m_vertexFaceOffsets[m_F(f, c) + 1]++;
+            for (int v = 0; v < m_V.rows(); ++v)
+                m_vertexFaceOffsets[v + 1] += m_vertexFaceOffsets[v];
+            m_vertexFaces.resize(m_vertexFaceOffsets.back());
+            std::vector<int> fill(m_vertexFaceOffsets.begin(), m_vertexFaceOffsets.end() - 1);
+            for (int f = 0; f < m_F.rows(); ++f)
+                for (int c = 0; c < 3; ++c)
+                    m_vertexFaces[fill[m_F(f, c)]++] = f;
+        }
+        else if (m_meshDirty & MESH_DIRTY_POSITION)
+        {
+            StreamVertexPositions();
+        }
 
-        int width  = static_cast<int>(scale * (viewer->core().viewport[2] - viewer->core().viewport[0]));
-        int height = static_cast<int>(scale * (viewer->core().viewport[3] - viewer->core().viewport[1]));
+        if (m_meshDirty != MESH_DIRTY_NONE)
+        {
+            data.clear_points();
+            data.point_size = 20.f;
+            if (m_hoverVert >= 0 && m_hoverVert != m_clickVert)
+            {
+                data.add_points(m_V.row(m_hoverVert).cast<double>(), Eigen::RowVector3d(1, 1, 0));
+            }
+            if (m_clickVert >= 0)
+            {
+                data.add_points(m_V.row(m_clickVert).cast<double>(), Eigen::RowVector3d(0, 1, 0));
+            }
+        }
+        m_meshDirty = MESH_DIRTY_NONE;
+    }
+
+    // Writes positions and area weighted vertex normals into the float mirrors of `MeshGL` and re-uploads
+    // only those two buffers. `ViewerData::V` and the normals are updated in the same pass, so a later full
+    // upload (wireframe, inverted normals, face based shading, set_colors) and the camera see the current shape.
+    void FSViewer::StreamVertexPositions()
+    {
+        auto& data   = viewer->data();
+        auto& meshgl = data.meshgl;
+        // Per-corner layouts (face based shading, per-corner uv/normals) and an uninitialized GL mesh take the full path
+        if (data.face_based || !meshgl.is_initialized || meshgl.V_vbo.rows() != m_V.rows() ||
+            meshgl.V_normals_vbo.rows() != m_V.rows() || data.V.rows() != m_V.rows() ||
+            data.V_normals.rows() != m_V.rows() || data.F_normals.rows() != m_F.rows())
+        {
+            data.set_vertices(m_V.toMatrix<double>());
+            data.compute_normals();
+            return;
+        }
 
-        // Allocate temporary buffers for image
-        Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> r(width, height);
-        Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> g(width, height);
-        Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> b(width, height);
-        Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> a(width, height);
+        const int       num_faces = static_cast<int>(m_F.rows());
+        const int       num_verts = static_cast<int>(m_V.rows());
+        Eigen::MatrixXf face_normals(num_faces, 3);
+#pragma omp parallel for
+        for (int f = 0; f < num_faces; ++f)
+        {
+            Eigen::RowVector3f a = m_V.row(m_F(f, 0)).cast<float>();
+            Eigen::RowVector3f b = m_V.row(m_F(f, 1)).cast<float>();
+            Eigen::RowVector3f c = m_V.row(m_F(f, 2)).cast<float>();
+            Eigen::RowVector3f n = (b - a).cross(c - a);
+            face_normals.row(f)  = n; // length = 2 * area
+            const float length   = n.norm();
+            if (length > 0)
+                n /= length;
+            data.F_normals.row(f) = n.cast<double>();
+        }
+        const float sign = data.invert_normals ? -1.f : 1.f;
+#pragma omp parallel for
+        for (int v = 0; v < num_verts; ++v)
+        {
+            Eigen::RowVector3f n = Eigen::RowVector3f::Zero();
+            for (int k = m_vertexFaceOffsets[v]; k < m_vertexFaceOffsets[v + 1]; ++k)
+                n += face_normals.row(m_vertexFaces[k]);
+            // Vertices of degenerate faces only keep a zero normal instead of NaN
+            const float length = n.norm();
+            if (length > 0)
+                n /= length;
+            data.V_normals.row(v)       = n.cast<double>();
+            data.V.row(v)               = m_V.row(v).cast<double>();
+            meshgl.V_normals_vbo.row(v) = sign * n;
+            meshgl.V_vbo.row(v)         = m_V.row(v).cast<float>();
+        }
 
-        // Draw the scene in the buffers
-        viewer->core().draw_buffer(viewer->data(), false, r, g, b, a);
+        const GLsizeiptr bytes = static_cast<GLsizeiptr>(num_verts) * 3 * sizeof(float);
+        glBindBuffer(GL_ARRAY_BUFFER, meshgl.vbo_V);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, meshgl.V_vbo.data());
+        glBindBuffer(GL_ARRAY_BUFFER, meshgl.vbo_V_normals);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, meshgl.V_normals_vbo.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 
-        // Save it to a PNG
-        igl::stb::write_image(url, r, g, b, a);
+    // ======================================== Export data ========================================
+    void FSViewer::ExportPNG(std::string url) // Screenshot
+    {
+        // Captured at the end of the next scene draw and encoded in the background
+        m_pendingExportURL = url;
+        spdlog::info("> Export PNG: {}", url);
+    }
 
-        viewer->data().point_size /= scale;
+    void FSViewer::CaptureFrame()
+    {
+        if (!m_pendingExportURL.empty())
+        {
+            m_frameCapture->capture(m_frameBuffer->m_fbo, m_frameBuffer->m_width, m_frameBuffer->m_height, m_pendingExportURL);
+            m_pendingExportURL.clear();
+        }
+        if (m_isRecording)
+        {
+            std::string url = fmt::format("{}/frame_{:06d}.png", m_recordDir, m_recordFrame++);
+            m_frameCapture->capture(m_frameBuffer->m_fbo, m_frameBuffer->m_width, m_frameBuffer->m_height, url);
+        }
+        m_frameCapture->poll();
     }
 
     // ======================================== User interaction ========================================
+    void FSViewer::UpdateBVH()
+    {
+        if (m_bvhDirty == MESH_DIRTY_NONE)
+            return;
+        TriangleBoxes(m_V, m_F, m_faceBoxes);
+        if (m_bvhDirty & MESH_DIRTY_TOPOLOGY)
+            m_bvh.build(m_faceBoxes);
+        else
+            m_bvh.refit(m_faceBoxes);
+        m_bvhDirty = MESH_DIRTY_NONE;
+    }
+
+    // Window mouse position -> viewport coordinates of the scene image, y up
+    Eigen::Vector2f FSViewer::SceneCoordinates(float mouse_x, float mouse_y) const
+    {
+        float x = mouse_x - (m_sceneWindowPos.x - m_imguiContext->root_window_pos.x + m_sceneCursorPos.x);
+        float y = viewer->core().viewport(3) - (mouse_y - (m_sceneWindowPos.y - m_imguiContext->root_window_pos.y + m_sceneCursorPos.y));
+        return {x, y};
+    }
+
+    // Vertex closest to the ray hit under the cursor, -1 on a miss
+    int FSViewer::PickVertex(float mouse_x, float mouse_y)
+    {
+        UpdateBVH();
+        const Eigen::Vector2f xy   = SceneCoordinates(mouse_x, mouse_y);
+        const float           x    = xy.x();
+        const float           y    = xy.y();
+        const auto&           core = viewer->core();
+        Eigen::Vector3f near = igl::unproject(Eigen::Vector3f(x, y, 0.f), core.view, core.proj, core.viewport);
+        Eigen::Vector3f far  = igl::unproject(Eigen::Vector3f(x, y, 1.f), core.view, core.proj, core.viewport);
+
+        RayHit hit;
+        if (!IntersectRay(m_bvh, m_V, m_F, near.cast<Scalar>(), (far - near).cast<Scalar>(), hit))
+            return -1;
+        int c;
+        hit.bary.maxCoeff(&c);
+        return m_F(hit.face, c);
+    }
+
     bool FSViewer::mouse_down(int /*button*/, int modifier)
     {
         if (!m_isSceneInterationActive)
             return true;
         if (modifier != GLFW_MOD_CONTROL)
             return false;
-        float x = viewer->current_mouse_x - (m_sceneWindowPos.x - m_imguiContext->root_window_pos.x + m_sceneCursorPos.x);
-        float y = viewer->core().viewport(3) -
-                  (viewer->current_mouse_y - (m_sceneWindowPos.y - m_imguiContext->root_window_pos.y + m_sceneCursorPos.y));
-        int             fid;
-        Eigen::Vector3f bc;
-        bool            hit = igl::unproject_onto_mesh(
-            Eigen::Vector2f(x, y), viewer->core().view, viewer->core().proj, viewer->core().viewport, m_V, m_F, fid, bc);
-        if (hit)
-        {
-            int c;
-            bc.maxCoeff(&c);
-            m_clickVert = m_F(fid, c);
+        int v = PickVertex(viewer->current_mouse_x, viewer->current_mouse_y);
+        if (v >= 0)
+        {
+            m_clickVert = v;
+            MarkMeshDirty(MESH_DIRTY_SELECTION);
+            // Ctrl-drag pulls the vertex in the plane parallel to the screen through it
+            if (m_simulator.BeginDrag(v))
+            {
+                const auto& core = viewer->core();
+                m_dragDepth = igl::project(Eigen::Vector3f(m_V.row(v).cast<float>()), core.view, core.proj, core.viewport).z();
+            }
+            return true;
+        }
 
+        return false;
+    }
+
+    bool FSViewer::mouse_up(int /*button*/, int /*modifier*/)
+    {
+        if (m_simulator.IsDragging())
+        {
+            m_simulator.EndDrag();
             return true;
         }
+        return !m_isSceneInterationActive;
+    }
 
+    bool FSViewer::mouse_move(int mouse_x, int mouse_y)
+    {
+        if (m_simulator.IsDragging())
+        {
+            // Only the spring target moves; a paused simulation takes one step so the drag responds this frame
+            const Eigen::Vector2f xy     = SceneCoordinates(mouse_x, mouse_y);
+            const auto&           core   = viewer->core();
+            const Eigen::Vector3f target = igl::unproject(Eigen::Vector3f(xy.x(), xy.y(), m_dragDepth), core.view, core.proj, core.viewport);
+            m_simulator.DragTo(target.cast<Scalar>());
+            if (!viewer->core().is_animating)
+                m_isSingleStep = true;
+            return true;
+        }
+        if (!m_isSceneInterationActive)
+            return true;
+        if (m_isHoverEnabled)
+        {
+            int v = PickVertex(mouse_x, mouse_y);
+            if (v != m_hoverVert)
+            {
+                m_hoverVert = v;
+                MarkMeshDirty(MESH_DIRTY_SELECTION);
+            }
+        }
         return false;
     }
 
@@ -161,6 +373,65 @@ namespace FS
 
         // Mesh info
         ImGui::BulletText("%s", fmt::format("Mesh V = #{}, F = #{}", m_V.rows(), m_F.rows()).c_str());
+        ImGui::BulletText("%s", fmt::format("Tets V = #{}, T = #{}", m_simulator.m_TV.rows(), m_simulator.m_TT.rows()).c_str());
+        ImGui::BulletText("%s", fmt::format("Steps = {}", m_simulator.m_numSteps).c_str());
+        ImGui::BulletText("%s", fmt::format("Pins = {}", m_simulator.NumPins()).c_str());
+
+        // Solver, XPBD is a cheap preview while sculpting and PD the converged result
+        int solver = static_cast<int>(m_simulator.m_solverType);
+        if (ImGui::Combo("Solver", &solver, "Projective Dynamics\0XPBD (preview)\0"))
+        {
+            m_simulator.SetSolverType(static_cast<SolverType>(solver));
+            Reset();
+        }
+        if (m_simulator.m_solverType == SolverType::PD)
+        {
+            ImGui::SliderInt("PD Iterations", &m_simulator.m_solver.m_params.iterations, 1, 50);
+        }
+        else
+        {
+            ImGui::BulletText("%s", fmt::format("Colors = {}", m_simulator.m_xpbd.NumColors()).c_str());
+            ImGui::SliderInt("XPBD Substeps", &m_simulator.m_xpbd.m_params.substeps, 1, 20);
+            ImGui::SliderInt("XPBD Iterations", &m_simulator.m_xpbd.m_params.iterations, 1, 10);
+        }
+
+        // Self-collision, the broad phase only requeries after the surface moved by the slack
+        SelfCollision& collision = m_simulator.m_collision;
+        if (!collision.empty() && ImGui::CollapsingHeader("Self Collision"))
+        {
+            ImGui::Checkbox("Enabled", &collision.m_params.enabled);
+            float thickness = static_cast<float>(collision.m_thickness);
+            if (ImGui::InputFloat("Thickness", &thickness, 0.0f, 0.0f, "%.6f") && thickness > 0)
+                collision.setThickness(thickness);
+            ImGui::SliderInt("PD Contact Passes", &collision.m_params.iterations, 1, 20);
+            ImGui::BulletText("%s", fmt::format("Contacts = {}", collision.numContacts()).c_str());
+            ImGui::BulletText("%s",
+                              fmt::format("Candidates VT = {}, EE = {}, queries = {}",
+                                          collision.m_vertexTriangle.size(),
+                                          collision.m_edgeEdge.size(),
+                                          collision.m_numQueries)
+                                  .c_str());
+        }
+
+        // Muscle activations only change the local step, so scrubbing stays interactive
+        MuscleRig& rig = m_simulator.m_rig;
+        if (!rig.empty() && ImGui::CollapsingHeader("Muscles", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            for (Muscle& muscle : rig.m_muscles)
+            {
+                float activation = static_cast<float>(muscle.activation);
+                if (ImGui::SliderFloat(muscle.name.c_str(), &activation, 0.0f, 1.0f))
+                    muscle.activation = activation;
+            }
+        }
+        // The jaw only moves pin targets, the factorization is untouched
+        Jaw& jaw = rig.m_jaw;
+        if (!jaw.regions.empty())
+        {
+            float angle = static_cast<float>(jaw.angle);
+            if (ImGui::SliderFloat("Jaw Opening", &angle, 0.0f, static_cast<float>(jaw.max_angle)))
+                jaw.angle = angle;
+        }
 
         ImGui::End();
     }
@@ -203,31 +474,87 @@ namespace FS
             }
         }
 
-        { // Export current frame
+        { // Tetrahedralization, rebuilt (or loaded from the cache) on demand
+            TetParams& params = m_simulator.m_tetParams;
+            ImGui::SetNextItemWidth(w * 0.5f);
+            ImGui::InputDouble("Max Tet Volume", &params.max_volume, 0.0, 0.0, "%.6f");
+            ImGui::SetNextItemWidth(w * 0.5f);
+            ImGui::InputDouble("Radius-Edge Ratio", &params.radius_edge_ratio, 0.0, 0.0, "%.3f");
+            ImGui::Checkbox("Carve by Winding Number", &params.carve);
+            if (ImGui::Button("Rebuild Tets", {(w - p), 0}))
+            {
+                viewer->core().is_animating = false;
+                m_simulator.Reset(m_V);
+                Setup();
+                MarkMeshDirty(MESH_DIRTY_POSITION);
+            }
+        }
+
+        { // Muscles
+            if (!m_simulator.m_rig.empty() && ImGui::Button("Relax Muscles", {(w - p), 0}))
+            {
+                m_simulator.m_rig.resetActivations();
+                m_simulator.m_rig.m_jaw.angle = 0;
+            }
+        }
+
+        { // Picking, Ctrl-click selects a vertex
+            if (m_clickVert >= 0 && m_simulator.IsReady())
+            {
+                const char* label = m_simulator.IsPinned(m_clickVert) ? "Unpin Selected" : "Pin Selected";
+                if (ImGui::Button(label, {(w - p), 0}) && m_simulator.TogglePin(m_clickVert))
+                    MarkMeshDirty(MESH_DIRTY_SELECTION);
+            }
+            if (ImGui::Checkbox("Hover Highlight", &m_isHoverEnabled) && !m_isHoverEnabled)
+            {
+                m_hoverVert = -1;
+                MarkMeshDirty(MESH_DIRTY_SELECTION);
+            }
+        }
+
+        { // Export current frame and record frame sequence
             if (ImGui::Button("ExportPNG", {(w - p) * 0.5f, 0}))
             {
                 ExportPNG();
             }
+            ImGui::SameLine();
+            if (ImGui::Checkbox("Record Sequence", &m_isRecording) && m_isRecording)
+            {
+                m_recordFrame = 0;
+                spdlog::info("> Record sequence to {}", m_recordDir);
+            }
+            if (m_isRecording || m_frameCapture->pendingFrames() > 0)
+            {
+                ImGui::Text("Recorded %d frames, %zu pending", m_recordFrame, m_frameCapture->pendingFrames());
+            }
         }
 
         ImGui::End();
     }
 
     // https://github.com/Dreamtowards/Ethertia/blob/main/src/ethertia/imgui/Imgui_intl_draw.cpp#L1454
+    // `tail_colors`: color by p99 / p50 of the section, green for steady sections, red for 4x spikes and more
     static float RenderProfilerSection(const Util::Profiler::Section&                              sec,
                                        float                                                       x,
                                        float                                                       y,
                                        float                                                       full_width,
                                        float                                                       full_width_time,
-                                       const std::function<float(const Util::Profiler::Section&)>& timefunc)
+                                       const std::function<float(const Util::Profiler::Section&)>& timefunc,
+                                       bool                                                        tail_colors)
     {
         const float line_height = 16;
 
         double s_time  = timefunc(sec);
-        double s_width = (s_time / full_width_time) * full_width;
-        auto   rgba    = std::hash<std::string>()(sec.name) * 256;
+        double s_width = full_width_time > 0 ? (s_time / full_width_time) * full_width : 0.0;
+        auto   rgba    = sec.hash * 256;
         ImU32  col     = ImGui::GetColorU32(
             {((rgba >> 24) & 0xFF) / 255.0f, ((rgba >> 16) & 0xFF) / 255.0f, ((rgba >> 8) & 0xFF) / 255.0f, 1.0f});
+        if (tail_colors)
+        {
+            const double p50  = sec.histogram.percentile(0.5);
+            const float  tail = p50 > 0 ? std::clamp(static_cast<float>(sec.histogram.percentile(0.99) / p50 - 1) / 3, 0.f, 1.f) : 0.f;
+            col               = ImGui::GetColorU32({0.2f + 0.7f * tail, 0.8f - 0.6f * tail, 0.2f, 1.0f});
+        }
 
         ImVec2 min = {x, y};
         ImVec2 max = {static_cast<float>(min.x + s_width), min.y + line_height};
@@ -241,14 +568,69 @@ namespace FS
             ImGui::RenderText({max.x - text_size.x, min.y}, str.c_str());
         }
 
+        // Parallel sections: one lane per thread below the bar, busy time relative to the slowest thread
+        float lanes_height = 0;
+        if (sec.isParallel())
+        {
+            const float lane_height = 4;
+            double      slowest     = 0;
+            for (const Util::Profiler::ThreadTime& t : sec.threads)
+                slowest = std::max(slowest, t.sum_time);
+            lanes_height = lane_height * sec.threads.size();
+            for (size_t i = 0; i < sec.threads.size(); ++i)
+            {
+                const float  lane_y = y + line_height + lane_height * i;
+                const double busy   = slowest > 0 ? sec.threads[i].sum_time / slowest : 0.0;
+                ImGui::RenderFrame({x, lane_y}, {max.x, lane_y + lane_height - 1}, ImGui::GetColorU32(ImGuiCol_FrameBg));
+                ImGui::RenderFrame({x, lane_y}, {static_cast<float>(x + busy * s_width), lane_y + lane_height - 1}, col);
+            }
+            const ImVec2 lanes_min = {x, y + line_height};
+            const ImVec2 lanes_max = {max.x, y + line_height + lanes_height};
+            if (ImGui::IsWindowFocused() && ImGui::IsMouseHoveringRect(lanes_min, lanes_max))
+            {
+                const double team = sec.busy_time + sec.idle_time;
+                std::string  str  = sec.name + " per thread\n\n";
+                char         line[96];
+                for (size_t i = 0; i < sec.threads.size(); ++i)
+                {
+                    std::snprintf(line,
+                                  sizeof(line),
+                                  "T%-2zu %10.3fms %6zu calls\n",
+                                  i,
+                                  sec.threads[i].sum_time * 1000.0,
+                                  sec.threads[i].num_exec);
+                    str += line;
+                }
+                std::snprintf(line,
+                              sizeof(line),
+                              "\nimbalance %.2f\nidle      %.1f%%",
+                              sec.imbalance(),
+                              team > 0 ? 100.0 * sec.idle_time / team : 0.0);
+                str += line;
+                ImGui::SetTooltip("%s", str.c_str());
+            }
+        }
+
+        // Percentiles of the children do not add up to the parent's, keep them inside its bar
+        double children_time = 0;
+        for (const Util::Profiler::Section& sub_sec : sec.sections)
+            children_time += timefunc(sub_sec);
         float dx = 0;
         for (const Util::Profiler::Section& sub_sec : sec.sections)
         {
-            dx += RenderProfilerSection(sub_sec, x + dx, y + line_height, s_width, s_time, timefunc);
+            dx += RenderProfilerSection(
+                sub_sec, x + dx, y + line_height + lanes_height, s_width, std::max(s_time, children_time), timefunc, tail_colors);
         }
 
         if (ImGui::IsWindowFocused() && ImGui::IsMouseHoveringRect(min, max))
         {
+            std::string counters;
+            if (sec.hasCounters())
+                counters = fmt::format("\n\nIPC {:.2f}\ncycles/call {:.0f}\nLLC misses/call {:.1f}\nbranch misses/call {:.1f}",
+                                       sec.ipc(),
+                                       sec.perCall(Util::PerfCounters::CYCLES),
+                                       sec.perCall(Util::PerfCounters::LLC_MISSES),
+                                       sec.perCall(Util::PerfCounters::BRANCH_MISSES));
             ImGui::SetTooltip(
                 "%s\n"
                 "\n"
@@ -256,13 +638,24 @@ namespace FS
                 "las %fms\n"
                 "sum %fms\n"
                 "exc %u\n"
-                "%%p  %f",
+                "%%p  %f\n"
+                "\n"
+                "p50 %fms\n"
+                "p90 %fms\n"
+                "p99 %fms\n"
+                "max %fms"
+                "%s",
                 sec.name.c_str(),
                 sec.avg_time * 1000.0f,
                 sec.last_time * 1000.0f,
                 sec.sum_time * 1000.0f,
                 (uint32_t)sec.num_exec,
-                (float)(sec.parent ? sec.sum_time / sec.parent->sum_time : std::numeric_limits<float>::quiet_NaN()));
+                (float)(sec.parent ? sec.sum_time / sec.parent->sum_time : std::numeric_limits<float>::quiet_NaN()),
+                sec.histogram.percentile(0.5) * 1000.0,
+                sec.histogram.percentile(0.9) * 1000.0,
+                sec.histogram.percentile(0.99) * 1000.0,
+                sec.histogram.max_time * 1000.0,
+                counters.c_str());
         }
 
         return s_width;
@@ -284,7 +677,13 @@ namespace FS
             {"SumTime", [](const Util::Profiler::Section& sec) { return sec.sum_time; }},
             {"LastTime", [](const Util::Profiler::Section& sec) { return sec.last_time; }},
             {"AvgTime", [](const Util::Profiler::Section& sec) { return sec.avg_time; }},
+            // Percentile modes, bars are colored by how spiky the section is
+            {"P50", [](const Util::Profiler::Section& sec) { return sec.histogram.percentile(0.5); }},
+            {"P90", [](const Util::Profiler::Section& sec) { return sec.histogram.percentile(0.9); }},
+            {"P99", [](const Util::Profiler::Section& sec) { return sec.histogram.percentile(0.99); }},
+            {"Max", [](const Util::Profiler::Section& sec) { return sec.histogram.max_time; }},
         };
+        const bool percentile_mode = s_selected_time_func >= 3;
 
         ImGui::SetNextItemWidth(200);
         if (ImGui::BeginCombo("###Profiler", profilers[s_selected_profiler_idx].first))
@@ -317,21 +716,86 @@ namespace FS
         {
             prof.laterClearRootSection();
         }
+        ImGui::SameLine();
+        // Records every section call of the three profilers until saved, see Util/ChromeTrace.hpp
+        if (!g_FrameProfiler.isTracing())
+        {
+            if (ImGui::Button("Record Trace"))
+            {
+                for (const auto& [name, profiler] : profilers)
+                    profiler->startTrace();
+            }
+        }
+        else if (ImGui::Button("Save Trace"))
+        {
+            std::vector<std::pair<std::string, const Util::Profiler*>> traced;
+            for (const auto& [name, profiler] : profilers)
+            {
+                profiler->stopTrace();
+                traced.emplace_back(name, profiler);
+            }
+            std::error_code ec;
+            std::filesystem::create_directories(m_recordDir, ec);
+            Util::writeChromeTrace(fmt::format("{}/trace_step_{:06d}.json", m_recordDir, m_simulator.m_numSteps), traced);
+        }
+        ImGui::SameLine();
+        // Cycles, instructions, LLC and branch misses per section; unavailable in most containers
+        {
+            const bool available = Util::PerfCounters::available();
+            bool       enabled   = g_FrameProfiler.countersEnabled();
+            ImGui::BeginDisabled(!available);
+            if (ImGui::Checkbox("HW Counters", &enabled))
+            {
+                for (const auto& [name, profiler] : profilers)
+                    profiler->enableCounters(enabled);
+            }
+            ImGui::EndDisabled();
+            if (!available && ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+                ImGui::SetTooltip("%s", Util::PerfCounters::reason().c_str());
+        }
+
+        { // Recent frame times, the FRAME section of the last frame
+            const Util::Profiler::Section& frame = g_FrameProfiler.getRootSection();
+            if (frame.num_exec > 0)
+            {
+                if (m_frameTimes.size() < kNumFrameTimes)
+                    m_frameTimes.push_back(static_cast<float>(frame.last_time * 1000.0));
+                else
+                    m_frameTimes[m_frameTimeOffset] = static_cast<float>(frame.last_time * 1000.0);
+                m_frameTimeOffset = (m_frameTimeOffset + 1) % kNumFrameTimes;
+            }
+            if (!m_frameTimes.empty())
+            {
+                const float max_time = *std::max_element(m_frameTimes.begin(), m_frameTimes.end());
+                std::string overlay  = fmt::format("frame {:.2f} ms  p50 {:.2f}  p99 {:.2f}  max {:.2f}",
+                                                  m_frameTimes[(m_frameTimeOffset + m_frameTimes.size() - 1) % m_frameTimes.size()],
+                                                  frame.histogram.percentile(0.5) * 1000.0,
+                                                  frame.histogram.percentile(0.99) * 1000.0,
+                                                  frame.histogram.max_time * 1000.0);
+                ImGui::PlotLines("###FrameTimes",
+                                 m_frameTimes.data(),
+                                 static_cast<int>(m_frameTimes.size()),
+                                 m_frameTimes.size() < kNumFrameTimes ? 0 : m_frameTimeOffset,
+                                 overlay.c_str(),
+                                 0.0f,
+                                 max_time * 1.2f,
+                                 {ImGui::GetContentRegionAvail().x, 40});
+            }
+        }
 
         { // Profiler Section
             const Util::Profiler::Section& sec      = prof.getRootSection();
             auto&                          timefunc = s_time_funcs[s_selected_time_func].second;
-            ImVec2                         begin    = {ImGui::GetWindowPos().x + ImGui::GetWindowContentRegionMin().x,
-                                                       ImGui::GetWindowPos().y + ImGui::GetWindowContentRegionMin().y + 20};
-            float                          width    = ImGui::GetWindowContentRegionMax().x - ImGui::GetWindowContentRegionMin().x;
-            RenderProfilerSection(sec, begin.x, begin.y, width, timefunc(sec), timefunc);
+            ImVec2                         begin    = ImGui::GetCursorScreenPos();
+            float                          width    = ImGui::GetContentRegionAvail().x;
+            RenderProfilerSection(sec, begin.x, begin.y, width, timefunc(sec), timefunc, percentile_mode);
         }
         ImGui::End();
 
-        // reset step profiler each frame
+        // reset step profiler each frame, the histograms keep every step for the percentile modes
         if (viewer->core().is_animating)
         {
-            g_StepProfiler.laterClearRootSection();
+            g_StepProfiler.laterClearRootSection(true);
         }
     }
 
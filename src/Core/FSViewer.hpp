@@ -5,17 +5,20 @@
 #include <igl/opengl/glfw/ViewerPlugin.h>
 #include <spdlog/spdlog.h>
 
+#include "ImGuiContext/FrameCapture.hpp"
 #include "ImGuiContext/ImGuiContext.hpp"
 #include "ImGuiContext/OpenGLFrameBuffer.hpp"
 
+#include "Core/BVH.hpp"
+#include "Core/Scalar.hpp"
+#include "Core/Simulator.hpp"
+#include "Core/VertexBuffer.hpp"
 #include "Util/Profiler.hpp"
 
+#include <cstdint>
 #include <memory>
 #include <string>
-
-extern Util::Profiler g_FrameProfiler;
-extern Util::Profiler g_StepProfiler;
-extern Util::Profiler g_PreComputeProfiler;
+#include <vector>
 
 namespace FS
 {
@@ -24,11 +27,35 @@ namespace FS
     {
         std::unique_ptr<OpenGLFrameBuffer> m_frameBuffer;
         std::unique_ptr<ImGuiContext>      m_imguiContext;
+        std::unique_ptr<FrameCapture>      m_frameCapture;
 
-        Eigen::MatrixXd m_V;
+        VertexBufferS   m_V;
         Eigen::MatrixXi m_F;
-
-        int m_clickVert = -1;
+        Simulator       m_simulator;
+
+        int   m_clickVert      = -1;
+        int   m_hoverVert      = -1;
+        bool  m_isHoverEnabled = true;
+        float m_dragDepth      = 0.f; // window depth of the grabbed vertex, the drag plane
+
+        // What changed since the last upload to the GPU
+        enum MeshDirtyFlags : uint32_t
+        {
+            MESH_DIRTY_NONE      = 0,
+            MESH_DIRTY_POSITION  = 1 << 0, // vertex positions moved, topology unchanged
+            MESH_DIRTY_TOPOLOGY  = 1 << 1, // m_F or the vertex count changed
+            MESH_DIRTY_SELECTION = 1 << 2, // picked vertex overlay
+        };
+        uint32_t m_meshDirty = MESH_DIRTY_TOPOLOGY;
+
+        // Vertex -> incident faces (CSR), rebuilt with the topology for the normal update
+        std::vector<int> m_vertexFaceOffsets;
+        std::vector<int> m_vertexFaces;
+
+        // Picking BVH over m_F: rebuilt on topology changes, refit when vertices move
+        BVH                   m_bvh;
+        std::vector<BVH::Box> m_faceBoxes;
+        uint32_t              m_bvhDirty = MESH_DIRTY_TOPOLOGY;
 
         bool                m_isSceneInterationActive = true;
         std::pair<int, int> m_sceneWindowSize         = {1280, 800};
@@ -37,26 +64,57 @@ namespace FS
 
         bool m_isSingleStep = false;
 
+        // Frame capture: one-shot export and numbered sequence recording
+        std::string m_pendingExportURL;
+        bool        m_isRecording = false;
+        int         m_recordFrame = 0;
+        std::string m_recordDir   = "./Record";
+
+        // Profiler window sparkline: ring of the last frame times in ms
+        static constexpr size_t kNumFrameTimes = 240;
+        std::vector<float>      m_frameTimes;
+        size_t                  m_frameTimeOffset = 0;
+
     public:
         FSViewer()  = default;
         ~FSViewer() = default;
 
-        void Setup() {}
-        void Reset() {}
+        void Setup();
+        void Step();
+        void Reset();
 
     public:
         void init(igl::opengl::glfw::Viewer* _viewer) override;
-        void shutdown() override { m_imguiContext->end(); }
+        void shutdown() override
+        {
+            m_frameCapture->shutdown();
+            m_imguiContext->end();
+        }
 
         bool pre_draw() override;
 
+    public:
+        void MarkMeshDirty(uint32_t flags)
+        {
+            m_meshDirty |= flags;
+            m_bvhDirty |= flags & (MESH_DIRTY_POSITION | MESH_DIRTY_TOPOLOGY);
+        }
+
+    private:
+        void            UploadMesh();
+        void            StreamVertexPositions();
+        void            CaptureFrame();
+        void            UpdateBVH();
+        Eigen::Vector2f SceneCoordinates(float mouse_x, float mouse_y) const;
+        int             PickVertex(float mouse_x, float mouse_y);
+
     public:
         void ExportPNG(std::string url = "./Default_FSViewer_Export.png");
 
     public:
         bool mouse_down(int button, int modifier) override;
-        bool mouse_move(int /*mouse_x*/, int /*mouse_y*/) override { return !m_isSceneInterationActive; }
-        bool mouse_up(int /*button*/, int /*modifier*/) override { return !m_isSceneInterationActive; }
+        bool mouse_move(int mouse_x, int mouse_y) override;
+        bool mouse_up(int button, int modifier) override;
         bool mouse_scroll(float /*delta_y*/) override { return !m_isSceneInterationActive; }
 
         bool key_pressed(unsigned int /*key*/, int /*modifiers*/) override { return !m_isSceneInterationActive; }
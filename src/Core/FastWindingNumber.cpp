@@ -0,0 +1,145 @@
+#include "Core/FastWindingNumber.hpp"
+
+#include <cmath>
+
+namespace FS
+{
+
+    static constexpr Scalar kInv4Pi = Scalar(0.25 / 3.14159265358979323846);
+
+    Scalar FastWindingNumber::triangleWindingNumber(const Vector3s& a, const Vector3s& b, const Vector3s& c, const Vector3s& q)
+    {
+        // Van Oosterom and Strackee
+        Vector3s qa = a - q, qb = b - q, qc = c - q;
+        Scalar   la = qa.norm(), lb = qb.norm(), lc = qc.norm();
+        Scalar   numerator   = qa.dot(qb.cross(qc));
+        Scalar   denominator = la * lb * lc + qa.dot(qb) * lc + qb.dot(qc) * la + qc.dot(qa) * lb;
+        return 2 * std::atan2(numerator, denominator) * kInv4Pi;
+    }
+
+    void FastWindingNumber::build(const MatrixXs& V, const Eigen::MatrixXi& F)
+    {
+        m_V                 = V;
+        m_F                 = F;
+        const int num_faces = static_cast<int>(F.rows());
+
+        std::vector<BVH::Box> boxes(num_faces);
+        std::vector<Vector3s> face_normals(num_faces);
+        std::vector<Vector3s> face_centers(num_faces);
+        std::vector<Scalar>   face_areas(num_faces);
+#pragma omp parallel for
+        for (int f = 0; f < num_faces; ++f)
+        {
+            Vector3s a = V.row(F(f, 0)).transpose(), b = V.row(F(f, 1)).transpose(), c = V.row(F(f, 2)).transpose();
+            BVH::Box box(a);
+            box.extend(b);
+            box.extend(c);
+            boxes[f]        = box;
+            face_normals[f] = Scalar(0.5) * (b - a).cross(c - a);
+            face_areas[f]   = face_normals[f].norm();
+            face_centers[f] = (a + b + c) / 3;
+        }
+        m_bvh.build(boxes);
+
+        const int num_nodes = static_cast<int>(m_bvh.m_nodes.size());
+        m_centers.assign(num_nodes, Vector3s::Zero());
+        m_normals.assign(num_nodes, Vector3s::Zero());
+        m_moments.assign(num_nodes, Matrix3s::Zero());
+        m_radii.assign(num_nodes, 0);
+        std::vector<Scalar> areas(num_nodes, 0);
+        // Children are stored after their parent, so a reverse sweep sees them first
+        for (int i = num_nodes - 1; i >= 0; --i)
+        {
+            const BVH::Node& node = m_bvh.m_nodes[i];
+            Vector3s         weighted_center = Vector3s::Zero();
+            if (node.isLeaf())
+            {
+                for (int k = node.begin; k < node.end; ++k)
+                {
+                    int f = m_bvh.m_primitives[k];
+                    m_normals[i] += face_normals[f];
+                    areas[i] += face_areas[f];
+                    weighted_center += face_areas[f] * face_centers[f];
+                }
+            }
+            else
+            {
+                for (int child : {node.left, node.right})
+                {
+                    m_normals[i] += m_normals[child];
+                    areas[i] += areas[child];
+                    weighted_center += areas[child] * m_centers[child];
+                }
+            }
+            m_centers[i] = areas[i] > 0 ? Vector3s(weighted_center / areas[i]) : Vector3s(node.box.center());
+            // First moment about the node center, children are shifted to it
+            if (node.isLeaf())
+            {
+                for (int k = node.begin; k < node.end; ++k)
+                {
+                    int f = m_bvh.m_primitives[k];
+                    m_moments[i] += (face_centers[f] - m_centers[i]) * face_normals[f].transpose();
+                }
+            }
+            else
+            {
+                for (int child : {node.left, node.right})
+                    m_moments[i] += m_moments[child] + (m_centers[child] - m_centers[i]) * m_normals[child].transpose();
+            }
+            // Radius of a ball around the center containing the whole cluster
+            Vector3s far_corner = (node.box.min() - m_centers[i]).cwiseAbs().cwiseMax((node.box.max() - m_centers[i]).cwiseAbs());
+            m_radii[i]          = far_corner.norm();
+        }
+    }
+
+    Scalar FastWindingNumber::query(const Vector3s& q) const
+    {
+        if (m_bvh.empty())
+            return 0;
+        Scalar w = 0;
+        int    stack[64];
+        int    top   = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            int              index = stack[--top];
+            const BVH::Node& node  = m_bvh.m_nodes[index];
+            Vector3s         d     = m_centers[index] - q;
+            Scalar           dist2 = d.squaredNorm();
+            if (dist2 > m_beta * m_beta * m_radii[index] * m_radii[index])
+            {
+                // Taylor expansion of (x - q) / |x - q|^3 around the center: dipole + Jacobian : first moment
+                const Matrix3s& M         = m_moments[index];
+                Scalar          inv_dist3 = 1 / (dist2 * std::sqrt(dist2));
+                Scalar          order1    = d.dot(m_normals[index]);
+                Scalar          order2    = M.trace() - 3 * d.dot(M * d) / dist2;
+                w += (order1 + order2) * inv_dist3 * kInv4Pi;
+            }
+            else if (node.isLeaf())
+            {
+                for (int k = node.begin; k < node.end; ++k)
+                {
+                    int f = m_bvh.m_primitives[k];
+                    w += triangleWindingNumber(
+                        m_V.row(m_F(f, 0)).transpose(), m_V.row(m_F(f, 1)).transpose(), m_V.row(m_F(f, 2)).transpose(), q);
+                }
+            }
+            else
+            {
+                stack[top++] = node.right;
+                stack[top++] = node.left;
+            }
+        }
+        return w;
+    }
+
+    void FastWindingNumber::query(const MatrixXs& Q, VectorXs& W) const
+    {
+        const int num_queries = static_cast<int>(Q.rows());
+        W.resize(num_queries);
+#pragma omp parallel for schedule(dynamic, 256)
+        for (int i = 0; i < num_queries; ++i)
+            W(i) = query(Q.row(i).transpose());
+    }
+
+} // namespace FS
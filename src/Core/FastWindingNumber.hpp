@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Core/BVH.hpp"
+#include "Core/Scalar.hpp"
+
+#include <Eigen/Core>
+
+#include <vector>
+
+namespace FS
+{
+
+    // Generalized winding number of a triangle soup with the tree approximation of Barill et al. 2018.
+    // Far clusters are replaced by a second order expansion around their area weighted center (dipole plus the
+    // first moment of the normals); a node is far when the query is more than `beta` times its radius away.
+    // Near leaves use the exact solid angle. Larger beta is more accurate and slower.
+    struct FastWindingNumber
+    {
+        BVH             m_bvh;
+        MatrixXs        m_V;
+        Eigen::MatrixXi m_F;
+
+        // Per BVH node expansion
+        std::vector<Vector3s> m_centers;
+        std::vector<Vector3s> m_normals; // sum of area * unit normal
+        std::vector<Matrix3s> m_moments; // sum of area * (centroid - center) * unit normal^T
+        std::vector<Scalar>   m_radii;
+
+        Scalar m_beta = 2;
+
+        void build(const MatrixXs& V, const Eigen::MatrixXi& F);
+
+        Scalar query(const Vector3s& q) const;
+        // Parallel over the rows of Q
+        void query(const MatrixXs& Q, VectorXs& W) const;
+
+        // Exact solid angle of triangle (a, b, c) seen from q divided by 4 pi
+        static Scalar triangleWindingNumber(const Vector3s& a, const Vector3s& b, const Vector3s& c, const Vector3s& q);
+    };
+
+} // namespace FS
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Util/MeshCache.hpp"
+#include "Util/ReadOBJ.hpp"
+#include "Util/WeldVertices.hpp"
+
+#include "igl/readSTL.h"
+#include "igl/read_triangle_mesh.h"
+
+#include <chrono>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string>
+
+namespace FS
+{
+
+    // Loads a triangle mesh (.stl/.obj/.off) through the binary mesh cache. Shared by the viewer and the
+    // headless runner, so it must not depend on OpenGL.
+    template<typename DerivedV, typename DerivedF>
+    bool LoadMesh(Eigen::PlainObjectBase<DerivedV>& V, Eigen::PlainObjectBase<DerivedF>& F, std::string meshURL, double weld_eps = 0.0)
+    {
+        spdlog::info("Loading mesh from {}", meshURL);
+        auto begin_time = std::chrono::steady_clock::now();
+        auto elapsed_ms = [&begin_time]() {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+        };
+
+        // Binary cache keyed by the content of the source file and the load parameters
+        uint64_t cache_key = 0;
+        {
+            Util::MappedFile source;
+            if (!source.open(meshURL))
+            {
+                spdlog::error("Failed to open {}", meshURL);
+                return false;
+            }
+            cache_key = Util::hashCombine(Util::hashBytes(source.data(), source.size()), std::hash<double>()(weld_eps));
+        }
+        std::string cache_url = Util::MeshCache::cacheURL(meshURL, "mesh");
+        if (Util::loadCache(cache_url, cache_key, V, F))
+        {
+            spdlog::info("Mesh loaded: {} vertices, {} faces", V.rows(), F.rows());
+            spdlog::info("Mesh load time: {:.2f} ms (warm, from {})", elapsed_ms(), cache_url);
+            return true;
+        }
+
+        std::string file_suffix = meshURL.substr(meshURL.find_last_of('.') + 1);
+        if (file_suffix == "stl")
+        {
+            std::ifstream input(meshURL, std::ios::in | std::ios::binary);
+            if (!input)
+            {
+                spdlog::error("Failed to open {}", meshURL);
+                return false;
+            }
+            Eigen::MatrixXd n;
+            bool            success = igl::readSTL(input, V, F, n);
+            input.close();
+            if (!success)
+            {
+                spdlog::error("Failed to read {}", meshURL);
+                return false;
+            }
+            // STL stores a triangle soup, weld coincident corners
+            Util::WeldStats stats = Util::weldVertices(V, F, weld_eps);
+            spdlog::info("Welded STL vertices (eps = {}): {} -> {}, {} merged, {} degenerate faces",
+                         weld_eps,
+                         stats.input_vertices,
+                         stats.output_vertices,
+                         stats.welded_vertices,
+                         stats.degenerate_faces);
+        }
+        else if (file_suffix == "obj")
+        {
+            if (!Util::readOBJParallel(meshURL, V, F))
+            {
+                spdlog::error("Failed to read {}", meshURL);
+                return false;
+            }
+        }
+        else if (file_suffix == "off")
+        {
+            if (!igl::read_triangle_mesh(meshURL, V, F))
+            {
+                spdlog::error("Failed to read {}", meshURL);
+                return false;
+            }
+        }
+        else
+        {
+            spdlog::error("Unsupported mesh format: {}", meshURL);
+            return false;
+        }
+
+        spdlog::info("Mesh loaded: {} vertices, {} faces", V.rows(), F.rows());
+        double parse_ms = elapsed_ms();
+        Util::storeCache(cache_url, cache_key, V, F);
+        spdlog::info("Mesh load time: {:.2f} ms (cold, cache written in {:.2f} ms)", parse_ms, elapsed_ms() - parse_ms);
+        return true;
+    }
+
+} // namespace FS
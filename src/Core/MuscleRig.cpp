@@ -0,0 +1,165 @@
+#include "Core/MuscleRig.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace FS
+{
+
+    static Vector3s ReadVector3(const nlohmann::json& j)
+    {
+        return Vector3s(j.at(0).get<Scalar>(), j.at(1).get<Scalar>(), j.at(2).get<Scalar>());
+    }
+
+    static RigRegion ReadRegion(const nlohmann::json& j)
+    {
+        RigRegion region;
+        if (j.contains("radius"))
+        {
+            region.center = ReadVector3(j.at("center"));
+            region.radius = j.at("radius").get<Scalar>();
+        }
+        else
+        {
+            region.min = ReadVector3(j.at("min"));
+            region.max = ReadVector3(j.at("max"));
+        }
+        return region;
+    }
+
+    bool MuscleRig::load(const std::string& url)
+    {
+        std::ifstream file(url);
+        if (!file)
+        {
+            spdlog::error("Cannot open muscle rig {}", url);
+            return false;
+        }
+        try
+        {
+            nlohmann::json         rig = nlohmann::json::parse(file);
+            std::vector<Muscle>    muscles;
+            std::vector<RigRegion> skull;
+            Jaw                    jaw;
+            for (const nlohmann::json& j : rig.value("muscles", nlohmann::json::array()))
+            {
+                Muscle muscle;
+                muscle.name            = j.at("name").get<std::string>();
+                muscle.origin          = ReadVector3(j.at("origin"));
+                muscle.insertion       = ReadVector3(j.at("insertion"));
+                muscle.radius          = j.at("radius").get<Scalar>();
+                muscle.max_contraction = std::clamp(j.value("max_contraction", muscle.max_contraction), Scalar(0), Scalar(0.9));
+                if ((muscle.insertion - muscle.origin).norm() <= 0 || muscle.radius <= 0)
+                {
+                    spdlog::warn("Skipping degenerate muscle {}", muscle.name);
+                    continue;
+                }
+                muscles.push_back(std::move(muscle));
+            }
+            for (const nlohmann::json& j : rig.value("skull", nlohmann::json::array()))
+                skull.push_back(ReadRegion(j));
+            if (rig.contains("jaw"))
+            {
+                const nlohmann::json& j = rig.at("jaw");
+                jaw.pivot               = ReadVector3(j.at("pivot"));
+                jaw.axis                = ReadVector3(j.at("axis"));
+                jaw.max_angle           = j.value("max_angle", jaw.max_angle);
+                for (const nlohmann::json& r : j.at("regions"))
+                    jaw.regions.push_back(ReadRegion(r));
+                if (jaw.axis.norm() <= 0)
+                {
+                    spdlog::error("Invalid muscle rig {}: zero jaw axis", url);
+                    return false;
+                }
+            }
+            m_muscles = std::move(muscles);
+            m_skull   = std::move(skull);
+            m_jaw     = std::move(jaw);
+        }
+        catch (const nlohmann::json::exception& e)
+        {
+            spdlog::error("Invalid muscle rig {}: {}", url, e.what());
+            return false;
+        }
+        m_tetMuscle.clear();
+        m_tetFiber.clear();
+        spdlog::info("Loaded {} muscles, {} skull and {} jaw regions from {}", m_muscles.size(), m_skull.size(), m_jaw.regions.size(), url);
+        return true;
+    }
+
+    void MuscleRig::assign(const MatrixXs& TV, const Eigen::MatrixXi& TT)
+    {
+        const int m = static_cast<int>(TT.rows());
+        m_tetMuscle.assign(m, -1);
+        m_tetFiber.assign(m, Vector3s::Zero());
+        if (empty())
+            return;
+        const int num_muscles = static_cast<int>(m_muscles.size());
+#pragma omp parallel for
+        for (int t = 0; t < m; ++t)
+        {
+            Vector3s center = Vector3s::Zero();
+            for (int c = 0; c < 4; ++c)
+                center += TV.row(TT(t, c)).transpose() / 4;
+            Scalar best = std::numeric_limits<Scalar>::max();
+            for (int k = 0; k < num_muscles; ++k)
+            {
+                const Muscle& muscle = m_muscles[k];
+                Vector3s      axis   = muscle.insertion - muscle.origin;
+                Scalar        s      = std::clamp((center - muscle.origin).dot(axis) / axis.squaredNorm(), Scalar(0), Scalar(1));
+                Scalar        dist   = (center - muscle.origin - s * axis).norm();
+                if (dist <= muscle.radius && dist < best)
+                {
+                    best           = dist;
+                    m_tetMuscle[t] = k;
+                    m_tetFiber[t]  = axis.normalized();
+                }
+            }
+        }
+        std::vector<int> counts(num_muscles, 0);
+        for (int k : m_tetMuscle)
+            if (k >= 0)
+                counts[k]++;
+        for (int k = 0; k < num_muscles; ++k)
+        {
+            if (counts[k] == 0)
+                spdlog::warn("Muscle {} contains no tets", m_muscles[k].name);
+        }
+    }
+
+    int MuscleRig::findMuscle(const std::string& name) const
+    {
+        for (int k = 0; k < static_cast<int>(m_muscles.size()); ++k)
+            if (m_muscles[k].name == name)
+                return k;
+        return -1;
+    }
+
+    void MuscleRig::resetActivations()
+    {
+        for (Muscle& muscle : m_muscles)
+            muscle.activation = 0;
+    }
+
+    bool MuscleRig::activeShape(int t, Matrix3s& A, Matrix3s* A_inv) const
+    {
+        if (t >= static_cast<int>(m_tetMuscle.size()) || m_tetMuscle[t] < 0)
+            return false;
+        const Muscle& muscle = m_muscles[m_tetMuscle[t]];
+        if (muscle.activation <= 0)
+            return false;
+        const Scalar   s       = 1 - std::clamp(muscle.activation, Scalar(0), Scalar(1)) * muscle.max_contraction;
+        const Scalar   s_cross = 1 / std::sqrt(s);
+        const Matrix3s ff      = m_tetFiber[t] * m_tetFiber[t].transpose();
+        const Matrix3s cross   = Matrix3s::Identity() - ff;
+        A                      = s * ff + s_cross * cross;
+        if (A_inv)
+            *A_inv = ff / s + cross / s_cross;
+        return true;
+    }
+
+} // namespace FS
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "Core/Scalar.hpp"
+
+#include <string>
+#include <vector>
+
+namespace FS
+{
+
+    // A muscle modeled as a line segment from origin to insertion; tets within `radius` of the segment belong to it
+    // and their fibers run along the segment.
+    struct Muscle
+    {
+        std::string name;
+        Vector3s    origin          = Vector3s::Zero();
+        Vector3s    insertion       = Vector3s::Zero();
+        Scalar      radius          = 0;
+        Scalar      max_contraction = Scalar(0.3); // fiber shortening at full activation
+        Scalar      activation      = 0;           // in [0, 1], driven by the UI or a script
+    };
+
+    // Sphere (radius > 0) or axis-aligned box selecting the tet vertices of an attachment
+    struct RigRegion
+    {
+        Vector3s center = Vector3s::Zero();
+        Scalar   radius = 0;
+        Vector3s min    = Vector3s::Zero();
+        Vector3s max    = Vector3s::Zero();
+
+        bool contains(const Vector3s& p) const
+        {
+            if (radius > 0)
+                return (p - center).squaredNorm() <= radius * radius;
+            return (p.array() >= min.array()).all() && (p.array() <= max.array()).all();
+        }
+    };
+
+    // Rigid jaw rotating about an axis through the pivot; only the targets of its attachments move
+    struct Jaw
+    {
+        std::vector<RigRegion> regions;
+        Vector3s               pivot     = Vector3s::Zero();
+        Vector3s               axis      = Vector3s::UnitX();
+        Scalar                 angle     = 0; // radians, driven by the UI or a script
+        Scalar                 max_angle = Scalar(0.35);
+
+        Vector3s transform(const Vector3s& rest) const
+        {
+            return pivot + Eigen::AngleAxis<Scalar>(angle, axis.normalized()) * (rest - pivot);
+        }
+    };
+
+    // Named muscle groups with per-tet fiber directions. Activation contracts a tet's rest shape along the fiber,
+    // volume preserving: A = s f f^T + (I - f f^T) / sqrt(s) with s = 1 - activation * max_contraction.
+    // The solvers project onto R A instead of R, so an activation change only alters the local step / right-hand
+    // side and never the system matrix.
+    //
+    // Tet vertices inside the skull regions are attached to the (static) skull, the ones inside the jaw regions
+    // to the jaw.
+    //
+    // Rig file (JSON, mesh units), all sections optional:
+    //   { "muscles": [ { "name": "zygomaticus_l", "origin": [x, y, z], "insertion": [x, y, z],
+    //                    "radius": r, "max_contraction": 0.3 }, ... ],
+    //     "skull":   [ { "center": [x, y, z], "radius": r }, { "min": [x, y, z], "max": [x, y, z] }, ... ],
+    //     "jaw":     { "pivot": [x, y, z], "axis": [x, y, z], "max_angle": 0.35, "regions": [ ... ] } }
+    struct MuscleRig
+    {
+        std::vector<Muscle>   m_muscles;
+        std::vector<int>      m_tetMuscle; // per tet, -1 for passive tissue
+        std::vector<Vector3s> m_tetFiber;  // per tet, unit fiber direction in rest space
+
+        std::vector<RigRegion> m_skull;
+        Jaw                    m_jaw;
+
+    public:
+        bool load(const std::string& url);
+        // Assigns every tet to the nearest muscle segment within its radius
+        void assign(const MatrixXs& TV, const Eigen::MatrixXi& TT);
+
+        bool empty() const { return m_muscles.empty(); }
+        bool hasAttachments() const { return !m_skull.empty() || !m_jaw.regions.empty(); }
+        int  findMuscle(const std::string& name) const;
+        void resetActivations();
+
+        // Active rest shape of tet `t` (symmetric) and optionally its inverse; false for passive or relaxed tets (A = I)
+        bool activeShape(int t, Matrix3s& A, Matrix3s* A_inv = nullptr) const;
+    };
+
+} // namespace FS
@@ -0,0 +1,381 @@
+#include "Core/PDSolver.hpp"
+
+#include "Core/SVD3.hpp"
+#include "Util/Profiler.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <spdlog/spdlog.h>
+
+namespace FS
+{
+
+    bool PDSolver::Setup(const MatrixXs& X, const Eigen::MatrixXi& T, const std::vector<int>& pins)
+    {
+        PROFILE_PREC("PD_SETUP");
+        m_isReady      = false;
+        m_X            = X;
+        m_T            = T;
+        m_pins         = pins;
+        m_dragVertex   = -1;
+        m_contactVertices.clear();
+        const int    n = static_cast<int>(X.rows());
+        const int    m = static_cast<int>(T.rows());
+        const Scalar h = m_params.dt;
+        VectorXs     volumes(m);
+
+        {
+            PROFILE_PREC("TET_GRADIENTS");
+            m_D.resize(m);
+            m_weights.resize(m);
+            m_projections.assign(m, TetGradient::Zero());
+#pragma omp parallel for
+            for (int t = 0; t < m; ++t)
+            {
+                Matrix3s Dm;
+                for (int c = 0; c < 3; ++c)
+                    Dm.col(c) = (X.row(T(t, c + 1)) - X.row(T(t, 0))).transpose();
+                Scalar volume = std::abs(Dm.determinant()) / 6;
+                volumes(t)    = volume;
+                if (volume <= std::numeric_limits<Scalar>::epsilon())
+                {
+                    // Sliver from the mesher: no stiffness and no contribution to the system
+                    m_D[t].setZero();
+                    m_weights(t) = 0;
+                    continue;
+                }
+                Matrix3s DmInv       = Dm.inverse();
+                m_D[t].row(0)        = -DmInv.colwise().sum();
+                m_D[t].bottomRows(3) = DmInv;
+                m_weights(t)         = m_params.stiffness * volume;
+            }
+        }
+
+        {
+            PROFILE_PREC("ADJACENCY");
+            m_vertexTetOffsets.assign(n + 1, 0);
+            for (int t = 0; t < m; ++t)
+                for (int c = 0; c < 4; ++c)
+                    m_vertexTetOffsets[T(t, c) + 1]++;
+            for (int v = 0; v < n; ++v)
+                m_vertexTetOffsets[v + 1] += m_vertexTetOffsets[v];
+            m_vertexTetCorners.resize(m_vertexTetOffsets.back());
+            std::vector<int> fill(m_vertexTetOffsets.begin(), m_vertexTetOffsets.end() - 1);
+            for (int t = 0; t < m; ++t)
+                for (int c = 0; c < 4; ++c)
+                    m_vertexTetCorners[fill[T(t, c)]++] = 4 * t + c;
+
+            // Lumped masses, a quarter of every incident tet
+            m_mass.resize(n);
+#pragma omp parallel for
+            for (int v = 0; v < n; ++v)
+            {
+                Scalar mass = 0;
+                for (int k = m_vertexTetOffsets[v]; k < m_vertexTetOffsets[v + 1]; ++k)
+                    mass += m_params.density * volumes(m_vertexTetCorners[k] / 4) / 4;
+                m_mass(v) = mass;
+            }
+            // Vertices without a tet (dropped by the mesher) keep a nominal mass so the system stays definite
+            Scalar mean_mass = n > 0 ? m_mass.sum() / n : Scalar(1);
+            for (int v = 0; v < n; ++v)
+                if (m_mass(v) <= 0)
+                    m_mass(v) = mean_mass > 0 ? mean_mass : Scalar(1);
+        }
+
+        {
+            PROFILE_PREC("ASSEMBLE");
+            std::vector<Eigen::Triplet<Scalar>> triplets;
+            triplets.reserve(static_cast<size_t>(m) * 16 + n + pins.size());
+            for (int v = 0; v < n; ++v)
+                triplets.emplace_back(v, v, m_mass(v) / (h * h));
+            for (int t = 0; t < m; ++t)
+            {
+                if (m_weights(t) == 0)
+                    continue;
+                Eigen::Matrix<Scalar, 4, 4> K = m_weights(t) * m_D[t] * m_D[t].transpose();
+                for (int a = 0; a < 4; ++a)
+                    for (int b = 0; b < 4; ++b)
+                        triplets.emplace_back(T(t, a), T(t, b), K(a, b));
+            }
+            for (int p : pins)
+                triplets.emplace_back(p, p, m_params.pin_stiffness);
+            m_A.resize(n, n);
+            m_A.setFromTriplets(triplets.begin(), triplets.end());
+            m_baseDiagonal = m_A.diagonal();
+            for (int p : pins)
+                m_baseDiagonal(p) -= m_params.pin_stiffness;
+        }
+
+        {
+            PROFILE_PREC("FACTORIZE");
+            if (!m_solver.compute(m_A))
+            {
+                spdlog::error("PD system factorization failed ({} vertices, {} tets)", n, m);
+                return false;
+            }
+            m_numFactorUpdates = 0;
+        }
+
+        m_pinTargets.resize(pins.size(), 3);
+        for (int i = 0; i < static_cast<int>(pins.size()); ++i)
+            m_pinTargets.row(i) = X.row(pins[i]);
+        Reset();
+        m_isReady = true;
+        spdlog::info("PD setup: {} vertices, {} tets, {} pins, {} nonzeros", n, m, pins.size(), m_A.nonZeros());
+        return true;
+    }
+
+    void PDSolver::Reset()
+    {
+        m_q = m_X;
+        m_v = MatrixXs::Zero(m_X.rows(), 3);
+    }
+
+    bool PDSolver::UpdateDiagonal(int v, Scalar w)
+    {
+        PROFILE_PREC("PD_FACTOR_UPDATE");
+        m_A.coeffRef(v, v) += w;
+        m_numFactorUpdates++;
+        // A downdate can fail from round-off when the removed weight dominates the diagonal, refactorize then
+        if (!m_solver.updateDiagonal(v, w) && !m_solver.factorize(m_A))
+        {
+            spdlog::error("PD system factorization failed after updating vertex {}", v);
+            m_isReady = false;
+            return false;
+        }
+        return true;
+    }
+
+    bool PDSolver::Refactorize()
+    {
+        PROFILE_PREC("PD_REFACTORIZE");
+        for (int v = 0; v < NumVertices(); ++v)
+            m_A.coeffRef(v, v) = m_baseDiagonal(v);
+        for (int p : m_pins)
+            m_A.coeffRef(p, p) += m_params.pin_stiffness;
+        if (m_dragVertex >= 0)
+            m_A.coeffRef(m_dragVertex, m_dragVertex) += m_params.drag_stiffness;
+        for (int v : m_contactVertices)
+            m_A.coeffRef(v, v) += m_params.contact_stiffness;
+        m_numFactorUpdates = 0;
+        if (!m_solver.factorize(m_A))
+        {
+            spdlog::error("PD system factorization failed");
+            m_isReady = false;
+            return false;
+        }
+        return true;
+    }
+
+    bool PDSolver::AddPin(int v, const RowVector3s& target)
+    {
+        if (!m_isReady || std::find(m_pins.begin(), m_pins.end(), v) != m_pins.end())
+            return false;
+        if (!UpdateDiagonal(v, m_params.pin_stiffness))
+            return false;
+        m_pins.push_back(v);
+        m_pinTargets.conservativeResize(m_pins.size(), 3);
+        m_pinTargets.bottomRows(1) = target;
+        return true;
+    }
+
+    bool PDSolver::RemovePin(int v)
+    {
+        auto it = std::find(m_pins.begin(), m_pins.end(), v);
+        if (!m_isReady || it == m_pins.end())
+            return false;
+        if (!UpdateDiagonal(v, -m_params.pin_stiffness))
+            return false;
+        const int i    = static_cast<int>(it - m_pins.begin());
+        const int last = static_cast<int>(m_pins.size()) - 1;
+        m_pins[i]      = m_pins[last];
+        m_pins.pop_back();
+        m_pinTargets.row(i) = m_pinTargets.row(last);
+        m_pinTargets.conservativeResize(last, 3);
+        return true;
+    }
+
+    bool PDSolver::SetDrag(int v, const RowVector3s& target)
+    {
+        if (!m_isReady || v < 0 || v >= NumVertices())
+            return false;
+        if (v != m_dragVertex)
+        {
+            ClearDrag();
+            if (!UpdateDiagonal(v, m_params.drag_stiffness))
+                return false;
+            m_dragVertex = v;
+        }
+        m_dragTarget = target;
+        return true;
+    }
+
+    void PDSolver::ClearDrag()
+    {
+        if (m_dragVertex >= 0 && m_isReady)
+            UpdateDiagonal(m_dragVertex, -m_params.drag_stiffness);
+        m_dragVertex = -1;
+    }
+
+    bool PDSolver::SetContactVertices(const std::vector<int>& vertices)
+    {
+        if (!m_isReady || vertices == m_contactVertices)
+            return m_isReady;
+        PROFILE_PREC("PD_CONTACT_SETUP");
+        // Contacts come and go a few vertices per step, each is a rank-one update along its etree path
+        constexpr size_t kMaxUpdates = 64;
+        std::vector<int> removed, added;
+        std::set_difference(m_contactVertices.begin(), m_contactVertices.end(), vertices.begin(), vertices.end(),
+                            std::back_inserter(removed));
+        std::set_difference(vertices.begin(), vertices.end(), m_contactVertices.begin(), m_contactVertices.end(),
+                            std::back_inserter(added));
+        if (removed.size() + added.size() <= kMaxUpdates)
+        {
+            for (int v : removed)
+                if (!UpdateDiagonal(v, -m_params.contact_stiffness))
+                    return false;
+            for (int v : added)
+                if (!UpdateDiagonal(v, m_params.contact_stiffness))
+                    return false;
+            m_contactVertices = vertices;
+            return true;
+        }
+        m_contactVertices = vertices;
+        return Refactorize();
+    }
+
+    void PDSolver::Step()
+    {
+        if (!m_isReady)
+            return;
+        PROFILE_STEP("PD_STEP");
+        if (m_numFactorUpdates >= kMaxFactorUpdates)
+        {
+            PROFILE_PREC("PRECOMPUTE");
+            if (!Refactorize())
+                return;
+        }
+        const Scalar h = m_params.dt;
+
+        // Inertial prediction s = q + h v + h^2 g
+        MatrixXs q_prev = m_q;
+        MatrixXs s      = m_q + h * m_v;
+        s.rowwise() += (h * h * m_params.gravity).transpose();
+        m_q = s;
+
+        if (!m_contactVertices.empty() && m_collision && m_collision->numContacts() > 0)
+        {
+            m_contactInvMass = m_mass.cwiseInverse();
+            for (int p : m_pins)
+                m_contactInvMass(p) = 0;
+        }
+
+        for (int it = 0; it < m_params.iterations; ++it)
+        {
+            LocalStep();
+            GlobalStep(s);
+        }
+
+        m_v = (m_q - q_prev) * (m_params.damping / h);
+    }
+
+    void PDSolver::LocalStep()
+    {
+        PROFILE_STEP("LOCAL");
+        using Kernel         = SVD3<Scalar, kSIMDLanes>;
+        const int m          = NumTets();
+        const int num_blocks = (m + kSIMDLanes - 1) / kSIMDLanes;
+        // Tets are processed kSIMDLanes at a time: gather F into SoA lanes, one batched polar decomposition, scatter
+        // Every thread records its own POLAR time, nowait so that the wait at the end of the region is left out
+#pragma omp parallel
+        {
+            PROFILE_STEP("POLAR");
+#pragma omp for schedule(static) nowait
+            for (int b = 0; b < num_blocks; ++b)
+            {
+                Kernel::P F[9], R[9];
+                Matrix3s  A[kSIMDLanes];
+                bool      active[kSIMDLanes];
+                for (int l = 0; l < kSIMDLanes; ++l)
+                {
+                    int      t  = b * kSIMDLanes + l;
+                    Matrix3s Fl = Matrix3s::Identity(); // padding and slivers
+                    active[l]   = false;
+                    if (t < m && m_weights(t) != 0)
+                    {
+                        Fl.setZero();
+                        for (int c = 0; c < 4; ++c)
+                            Fl += m_q.row(m_T(t, c)).transpose() * m_D[t].row(c);
+                        // Active muscle: the closest R A to F is polar(F A^T) A, and A is symmetric
+                        if (m_rig && m_rig->activeShape(t, A[l]))
+                        {
+                            active[l] = true;
+                            Fl        = Fl * A[l];
+                        }
+                    }
+                    for (int k = 0; k < 9; ++k)
+                        F[k].v[l] = Fl(k / 3, k % 3);
+                }
+                // Closest rotation, inverted tets are projected onto a rotation as well
+                Kernel::polar(F, R);
+                for (int l = 0; l < kSIMDLanes; ++l)
+                {
+                    int t = b * kSIMDLanes + l;
+                    if (t >= m || m_weights(t) == 0)
+                        continue;
+                    Matrix3s Rl;
+                    for (int k = 0; k < 9; ++k)
+                        Rl(k / 3, k % 3) = R[k].v[l];
+                    if (active[l])
+                        Rl = Rl * A[l];
+                    m_projections[t] = m_weights(t) * m_D[t] * Rl.transpose();
+                }
+            }
+        }
+    }
+
+    void PDSolver::GlobalStep(const MatrixXs& s)
+    {
+        PROFILE_STEP("GLOBAL");
+        const int    n      = NumVertices();
+        const Scalar inv_h2 = 1 / (m_params.dt * m_params.dt);
+        MatrixXs     b(n, 3);
+        {
+            PROFILE_STEP("RHS");
+#pragma omp parallel for schedule(static)
+            for (int v = 0; v < n; ++v)
+            {
+                RowVector3s rhs = m_mass(v) * inv_h2 * s.row(v);
+                for (int k = m_vertexTetOffsets[v]; k < m_vertexTetOffsets[v + 1]; ++k)
+                {
+                    int tc = m_vertexTetCorners[k];
+                    rhs += m_projections[tc / 4].row(tc % 4);
+                }
+                b.row(v) = rhs;
+            }
+            for (int i = 0; i < static_cast<int>(m_pins.size()); ++i)
+                b.row(m_pins[i]) += m_params.pin_stiffness * m_pinTargets.row(i);
+            if (m_dragVertex >= 0)
+                b.row(m_dragVertex) += m_params.drag_stiffness * m_dragTarget;
+        }
+        if (!m_contactVertices.empty())
+        {
+            PROFILE_STEP("CONTACTS");
+            MatrixXs projection = m_q;
+            if (m_collision && m_collision->numContacts() > 0)
+            {
+                for (int it = 0; it < m_collision->m_params.iterations; ++it)
+                    if (m_collision->solveContacts(projection, m_contactInvMass) == 0)
+                        break;
+            }
+            for (int v : m_contactVertices)
+                b.row(v) += m_params.contact_stiffness * projection.row(v);
+        }
+        {
+            PROFILE_STEP("SOLVE");
+            m_solver.solveInPlace(b);
+            m_q.swap(b);
+        }
+    }
+
+} // namespace FS
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Core/MuscleRig.hpp"
+#include "Core/Scalar.hpp"
+#include "Core/SelfCollision.hpp"
+#include "Core/SparseCholesky.hpp"
+
+#include <Eigen/Sparse>
+
+#include <vector>
+
+namespace FS
+{
+
+    struct PDParams
+    {
+        Scalar   dt                = Scalar(1) / 30;
+        int      iterations        = 10;
+        Scalar   stiffness         = Scalar(1e3); // strain constraint weight per unit rest volume
+        Scalar   density           = Scalar(1);
+        Scalar   pin_stiffness     = Scalar(1e5);  // attachment constraint weight
+        Scalar   drag_stiffness    = Scalar(1e4);  // mouse drag spring weight
+        Scalar   contact_stiffness = Scalar(1e4);  // weight of the contact projections of the vertices in contact
+        Scalar   damping           = Scalar(0.98); // velocity scale per step
+        Vector3s gravity           = Vector3s(0, Scalar(-9.8), 0);
+    };
+
+    // Projective Dynamics on a tet mesh (Bouaziz et al. 2014) with per-tet strain constraints and pin constraints.
+    //   local:  every tet projects its deformation gradient onto the closest rotation, in parallel SIMD batches (SVD3.hpp)
+    //   global: (M/h^2 + sum w G^T G) q = M/h^2 s + sum w G^T p, with the constant matrix factorized once
+    // The three coordinates share the same system matrix, so one n x n factorization serves all of them.
+    // Muscle tets project onto R A with the active rest shape A of `m_rig`, so activations only change the RHS.
+    // Moving pin targets (the jaw) only changes the RHS as well; adding or removing a pin is a rank-one update of
+    // the factor. The mouse drag is a soft pin: grabbing a vertex updates the factor once, moving the mouse only
+    // moves its target.
+    struct PDSolver
+    {
+        using SparseMatrixS = Eigen::SparseMatrix<Scalar>;
+        using TetGradient   = Eigen::Matrix<Scalar, 4, 3>; // maps the 4 corner positions to the deformation gradient
+
+        PDParams m_params;
+
+        MatrixXs        m_X; // rest positions, n x 3
+        Eigen::MatrixXi m_T; // tets, m x 4
+        MatrixXs        m_q; // current positions
+        MatrixXs        m_v; // velocities
+
+        VectorXs                 m_mass;        // lumped vertex masses
+        std::vector<TetGradient> m_D;           // per tet: F = X_local^T * D
+        VectorXs                 m_weights;     // per tet: stiffness * rest volume
+        std::vector<TetGradient> m_projections; // per tet: w * D * R^T, the local step's contribution to the RHS
+        const MuscleRig*         m_rig       = nullptr; // optional active material, indexed by tet
+        const SelfCollision*     m_collision = nullptr; // optional contacts, see SetContactVertices
+
+        // Vertex -> (tet * 4 + corner) incidences (CSR), used to gather the RHS without atomics
+        std::vector<int> m_vertexTetOffsets;
+        std::vector<int> m_vertexTetCorners;
+
+        std::vector<int> m_pins;
+        MatrixXs         m_pinTargets; // one row per pin
+
+        int         m_dragVertex = -1;
+        RowVector3s m_dragTarget = RowVector3s::Zero();
+
+        std::vector<int> m_contactVertices; // carry contact_stiffness on the diagonal
+        VectorXs         m_contactInvMass;  // contact projection weights, 0 for pins
+
+        SparseMatrixS  m_A;
+        VectorXs       m_baseDiagonal; // diagonal of m_A without pins, drag and contacts
+        SparseCholesky m_solver;
+        int            m_numFactorUpdates = 0; // rank-one updates since the last factorization of the exact matrix
+        bool           m_isReady          = false;
+
+        // Every rank-one update leaves round-off in the float factor; Step refactorizes after this many
+        static constexpr int kMaxFactorUpdates = 1024;
+
+    public:
+        // Precomputes and factorizes the system matrix, recorded in g_PreComputeProfiler
+        bool Setup(const MatrixXs& X, const Eigen::MatrixXi& T, const std::vector<int>& pins);
+        // One implicit time step, recorded in g_StepProfiler
+        void Step();
+        void Reset();
+
+        // Attaches tet vertex `v` to `target`, or detaches it, updating the factor instead of refactorizing.
+        // False if `v` already is / is not pinned.
+        bool AddPin(int v, const RowVector3s& target);
+        bool RemovePin(int v);
+        // Pulls tet vertex `v` towards `target` with drag_stiffness; repeated calls with the same vertex only move
+        // the target
+        bool SetDrag(int v, const RowVector3s& target);
+        void ClearDrag();
+        // Self-collision as a projective constraint: the vertices of the current contacts (sorted) carry
+        // contact_stiffness on the diagonal, and their target is their contact projection. A few changed vertices
+        // update the factor, larger changes refactorize once; an empty set leaves the system without contacts.
+        bool SetContactVertices(const std::vector<int>& vertices);
+
+        const MatrixXs& Positions() const { return m_q; }
+        int             NumVertices() const { return static_cast<int>(m_q.rows()); }
+        int             NumTets() const { return static_cast<int>(m_T.rows()); }
+
+    private:
+        void LocalStep();
+        void GlobalStep(const MatrixXs& s);
+        // A + w e_v e_v^T as a rank-one update of the factor, refactorizing if the update fails
+        bool UpdateDiagonal(int v, Scalar w);
+        // Rebuilds the diagonal of m_A from the current pins, drag and contacts and factorizes it, dropping the
+        // round-off of the updates since the last factorization
+        bool Refactorize();
+    };
+
+} // namespace FS
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "Core/Scalar.hpp"
+
+#include <cmath>
+
+namespace FS
+{
+
+    // Elements per SIMD register for the batched kernels, from the instruction set of the build
+#if defined(__AVX512F__)
+    constexpr int kSIMDBytes = 64;
+#elif defined(__AVX__)
+    constexpr int kSIMDBytes = 32;
+#elif defined(__SSE2__) || defined(_M_X64)
+    constexpr int kSIMDBytes = 16;
+#else
+    constexpr int kSIMDBytes = sizeof(Scalar);
+#endif
+    constexpr int kSIMDLanes = kSIMDBytes / sizeof(Scalar);
+
+    // W lanes of T. Every operation is a fixed-length loop over the lanes without branches, which the compiler
+    // maps to one vector instruction per operation (AVX2: 8 floats, AVX-512: 16 floats); W = 1 is the scalar path.
+    template<typename T, int W>
+    struct Pack
+    {
+        T v[W];
+
+        static Pack broadcast(T x)
+        {
+            Pack r;
+#pragma omp simd
+            for (int i = 0; i < W; ++i)
+                r.v[i] = x;
+            return r;
+        }
+
+#define FS_PACK_BINARY_OP(op)                                                                                          \
+    friend Pack operator op(const Pack& a, const Pack& b)                                                              \
+    {                                                                                                                  \
+        Pack r;                                                                                                        \
+        _Pragma("omp simd") for (int i = 0; i < W; ++i) r.v[i] = a.v[i] op b.v[i];                                     \
+        return r;                                                                                                      \
+    }
+        FS_PACK_BINARY_OP(+)
+        FS_PACK_BINARY_OP(-)
+        FS_PACK_BINARY_OP(*)
+        FS_PACK_BINARY_OP(/)
+#undef FS_PACK_BINARY_OP
+
+        friend Pack operator*(T a, const Pack& b) { return broadcast(a) * b; }
+        friend Pack operator-(const Pack& a)
+        {
+            Pack r;
+#pragma omp simd
+            for (int i = 0; i < W; ++i)
+                r.v[i] = -a.v[i];
+            return r;
+        }
+    };
+
+    namespace simd
+    {
+        template<typename T, int W>
+        Pack<T, W> rsqrt(const Pack<T, W>& a)
+        {
+            Pack<T, W> r;
+#pragma omp simd
+            for (int i = 0; i < W; ++i)
+                r.v[i] = T(1) / std::sqrt(a.v[i]);
+            return r;
+        }
+        template<typename T, int W>
+        Pack<T, W> sqrt(const Pack<T, W>& a)
+        {
+            Pack<T, W> r;
+#pragma omp simd
+            for (int i = 0; i < W; ++i)
+                r.v[i] = std::sqrt(a.v[i]);
+            return r;
+        }
+        template<typename T, int W>
+        Pack<T, W> abs(const Pack<T, W>& a)
+        {
+            Pack<T, W> r;
+#pragma omp simd
+            for (int i = 0; i < W; ++i)
+                r.v[i] = std::abs(a.v[i]);
+            return r;
+        }
+        template<typename T, int W>
+        Pack<T, W> max(const Pack<T, W>& a, const Pack<T, W>& b)
+        {
+            Pack<T, W> r;
+#pragma omp simd
+            for (int i = 0; i < W; ++i)
+                r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+            return r;
+        }
+        // Lane-wise `a < b ? x : y`
+        template<typename T, int W>
+        Pack<T, W> selectLess(const Pack<T, W>& a, const Pack<T, W>& b, const Pack<T, W>& x, const Pack<T, W>& y)
+        {
+            Pack<T, W> r;
+#pragma omp simd
+            for (int i = 0; i < W; ++i)
+                r.v[i] = a.v[i] < b.v[i] ? x.v[i] : y.v[i];
+            return r;
+        }
+    } // namespace simd
+
+    // 3x3 SVD of W matrices at once after McAdams et al. 2011, "Computing the Singular Value Decomposition of 3x3
+    // matrices with minimal branching and elementary floating point operations":
+    //   1. Jacobi eigenanalysis of A^T A with approximate Givens rotations (fixed number of sweeps) -> V
+    //   2. B = A V, columns sorted by decreasing norm
+    //   3. QR of B with Givens rotations -> U, diagonal of R = singular values
+    // U and V are rotations; for inverted elements the smallest singular value is negative.
+    // Matrices are SoA: M[3 * row + col].v[lane].
+    template<typename T, int W>
+    struct SVD3
+    {
+        using P = Pack<T, W>;
+
+        // 4 sweeps as in the paper leave errors up to 1e-3 in R for nearly equal singular values, 5 reach float precision
+        static constexpr int kSweeps = 5;
+
+        // Rotates the (p, q) plane by the angle with half-angle cosine/sine (ch, sh): S <- G^T S G, V <- V G
+        static void jacobiConjugate(int p, int q, P (&S)[9], P (&V)[9])
+        {
+            const T gamma = T(5.828427124746190); // 3 + 2 sqrt(2)
+            const T cstar = T(0.923879532511287); // cos(pi / 8)
+            const T sstar = T(0.382683432365090); // sin(pi / 8)
+
+            P ch  = T(2) * (S[3 * p + p] - S[3 * q + q]);
+            P sh  = S[3 * p + q];
+            P ch2 = ch * ch;
+            P sh2 = sh * sh;
+            P w   = simd::rsqrt(ch2 + sh2);
+            // Fall back to the pi/8 half angle when the approximate angle would exceed it
+            P gsh2 = gamma * sh2;
+            ch     = simd::selectLess(gsh2, ch2, w * ch, P::broadcast(cstar));
+            sh     = simd::selectLess(gsh2, ch2, w * sh, P::broadcast(sstar));
+            P c    = ch * ch - sh * sh;
+            P s    = T(2) * ch * sh;
+            rotateColumns(p, q, c, s, S);
+            rotateRows(p, q, c, s, S);
+            rotateColumns(p, q, c, s, V);
+        }
+
+        // M <- M G with G = I except G_pp = c, G_pq = -s, G_qp = s, G_qq = c
+        static void rotateColumns(int p, int q, const P& c, const P& s, P (&M)[9])
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                P mp         = M[3 * r + p];
+                P mq         = M[3 * r + q];
+                M[3 * r + p] = c * mp + s * mq;
+                M[3 * r + q] = c * mq - s * mp;
+            }
+        }
+        // M <- G^T M
+        static void rotateRows(int p, int q, const P& c, const P& s, P (&M)[9])
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                P mp         = M[3 * p + k];
+                P mq         = M[3 * q + k];
+                M[3 * p + k] = c * mp + s * mq;
+                M[3 * q + k] = c * mq - s * mp;
+            }
+        }
+
+        // Swaps columns p and q of B and V if |B_p| < |B_q|, negating one of them to keep det(V) = 1
+        static void sortColumns(int p, int q, P (&B)[9], P (&V)[9], P (&norm2)[3])
+        {
+            for (P* M : {B, V})
+            {
+                for (int r = 0; r < 3; ++r)
+                {
+                    P mp         = M[3 * r + p];
+                    P mq         = M[3 * r + q];
+                    M[3 * r + p] = simd::selectLess(norm2[p], norm2[q], mq, mp);
+                    M[3 * r + q] = simd::selectLess(norm2[p], norm2[q], -mp, mq);
+                }
+            }
+            P np     = norm2[p];
+            norm2[p] = simd::selectLess(np, norm2[q], norm2[q], np);
+            norm2[q] = simd::selectLess(np, norm2[q], np, norm2[q]);
+        }
+
+        // Zeroes B(q, p) with a Givens rotation of rows (p, q): B <- Q^T B, U <- U Q
+        static void givensQR(int p, int q, P (&B)[9], P (&U)[9])
+        {
+            const T eps = T(sizeof(T) == 4 ? 1e-6 : 1e-12);
+            P       a1  = B[3 * p + p];
+            P       a2  = B[3 * q + p];
+            P       rho = simd::sqrt(a1 * a1 + a2 * a2);
+            P       sh  = simd::selectLess(P::broadcast(eps), rho, a2, P::broadcast(0));
+            P       ch  = simd::abs(a1) + simd::max(rho, P::broadcast(eps));
+            // For a1 < 0 rotate by the complementary angle
+            P swap_ch = simd::selectLess(a1, P::broadcast(0), sh, ch);
+            P swap_sh = simd::selectLess(a1, P::broadcast(0), ch, sh);
+            P w       = simd::rsqrt(swap_ch * swap_ch + swap_sh * swap_sh);
+            ch        = swap_ch * w;
+            sh        = swap_sh * w;
+            P c       = ch * ch - sh * sh;
+            P s       = T(2) * ch * sh;
+            rotateRows(p, q, c, s, B);
+            rotateColumns(p, q, c, s, U);
+        }
+
+        static void compute(const P (&A)[9], P (&U)[9], P (&sigma)[3], P (&V)[9])
+        {
+            // S = A^T A
+            P S[9];
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    S[3 * i + j] = A[i] * A[j] + A[3 + i] * A[3 + j] + A[6 + i] * A[6 + j];
+            for (int k = 0; k < 9; ++k)
+                V[k] = P::broadcast(k % 4 == 0 ? T(1) : T(0));
+            for (int sweep = 0; sweep < kSweeps; ++sweep)
+            {
+                jacobiConjugate(0, 1, S, V);
+                jacobiConjugate(0, 2, S, V);
+                jacobiConjugate(1, 2, S, V);
+            }
+
+            // B = A V
+            P B[9];
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    B[3 * i + j] = A[3 * i] * V[j] + A[3 * i + 1] * V[3 + j] + A[3 * i + 2] * V[6 + j];
+            P norm2[3];
+            for (int j = 0; j < 3; ++j)
+                norm2[j] = B[j] * B[j] + B[3 + j] * B[3 + j] + B[6 + j] * B[6 + j];
+            sortColumns(0, 1, B, V, norm2);
+            sortColumns(0, 2, B, V, norm2);
+            sortColumns(1, 2, B, V, norm2);
+
+            for (int k = 0; k < 9; ++k)
+                U[k] = P::broadcast(k % 4 == 0 ? T(1) : T(0));
+            givensQR(0, 1, B, U);
+            givensQR(0, 2, B, U);
+            givensQR(1, 2, B, U);
+            sigma[0] = B[0];
+            sigma[1] = B[4];
+            sigma[2] = B[8];
+        }
+
+        // Closest rotation R = U V^T
+        static void polar(const P (&A)[9], P (&R)[9])
+        {
+            P U[9], V[9], sigma[3];
+            compute(A, U, sigma, V);
+            for (int i = 0; i < 3; ++i)
+                for (int j = 0; j < 3; ++j)
+                    R[3 * i + j] = U[3 * i] * V[3 * j] + U[3 * i + 1] * V[3 * j + 1] + U[3 * i + 2] * V[3 * j + 2];
+        }
+    };
+
+    // Closest rotations of n matrices, kSIMDLanes at a time with a padded tail
+    inline void PolarBatch(const Matrix3s* F, Matrix3s* R, int n)
+    {
+        using Kernel         = SVD3<Scalar, kSIMDLanes>;
+        using P              = Kernel::P;
+        const int num_blocks = (n + kSIMDLanes - 1) / kSIMDLanes;
+#pragma omp parallel for schedule(static)
+        for (int b = 0; b < num_blocks; ++b)
+        {
+            P A[9], Rb[9];
+            for (int l = 0; l < kSIMDLanes; ++l)
+            {
+                int e = b * kSIMDLanes + l;
+                for (int k = 0; k < 9; ++k)
+                    A[k].v[l] = e < n ? F[e](k / 3, k % 3) : Scalar(k % 4 == 0);
+            }
+            Kernel::polar(A, Rb);
+            for (int l = 0; l < kSIMDLanes && b * kSIMDLanes + l < n; ++l)
+            {
+                for (int k = 0; k < 9; ++k)
+                    R[b * kSIMDLanes + l](k / 3, k % 3) = Rb[k].v[l];
+            }
+        }
+    }
+
+} // namespace FS
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+namespace FS
+{
+
+    // Scalar type of the mesh and simulation state, selected at build time with the FS_DOUBLE_PRECISION option.
+    // Float halves the memory traffic and doubles the SIMD width; double is kept for accuracy validation.
+#ifdef FS_DOUBLE_PRECISION
+    using Scalar = double;
+#else
+    using Scalar = float;
+#endif
+
+    using MatrixXs    = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    using VectorXs    = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+    using Vector3s    = Eigen::Matrix<Scalar, 3, 1>;
+    using RowVector3s = Eigen::Matrix<Scalar, 1, 3>;
+    using Matrix3s    = Eigen::Matrix<Scalar, 3, 3>;
+
+} // namespace FS
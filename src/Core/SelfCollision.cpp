@@ -0,0 +1,424 @@
+#include "Core/SelfCollision.hpp"
+
+#include "Util/Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+
+namespace FS
+{
+
+    // Refits keep the topology of the tree, which degrades as the surface deforms
+    static constexpr int kRefitsPerRebuild = 32;
+
+    // Closest point to `p` on triangle (a, b, c) as barycentric weights (Ericson, Real-Time Collision Detection 5.1.5)
+    static Vector3s ClosestPointTriangle(const Vector3s& p, const Vector3s& a, const Vector3s& b, const Vector3s& c)
+    {
+        const Vector3s ab = b - a, ac = c - a, ap = p - a;
+        const Scalar   d1 = ab.dot(ap), d2 = ac.dot(ap);
+        if (d1 <= 0 && d2 <= 0)
+            return Vector3s(1, 0, 0);
+        const Vector3s bp = p - b;
+        const Scalar   d3 = ab.dot(bp), d4 = ac.dot(bp);
+        if (d3 >= 0 && d4 <= d3)
+            return Vector3s(0, 1, 0);
+        const Scalar vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0)
+        {
+            const Scalar v = d1 / (d1 - d3);
+            return Vector3s(1 - v, v, 0);
+        }
+        const Vector3s cp = p - c;
+        const Scalar   d5 = ab.dot(cp), d6 = ac.dot(cp);
+        if (d6 >= 0 && d5 <= d6)
+            return Vector3s(0, 0, 1);
+        const Scalar vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0)
+        {
+            const Scalar w = d2 / (d2 - d6);
+            return Vector3s(1 - w, 0, w);
+        }
+        const Scalar va = d3 * d6 - d5 * d4;
+        if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0)
+        {
+            const Scalar w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            return Vector3s(0, 1 - w, w);
+        }
+        const Scalar denom = 1 / (va + vb + vc);
+        const Scalar v     = vb * denom;
+        const Scalar w     = vc * denom;
+        return Vector3s(1 - v - w, v, w);
+    }
+
+    // Parameters (s, t) of the closest points of segments p0 p1 and q0 q1 (Ericson 5.1.9)
+    static void ClosestSegmentSegment(const Vector3s& p0, const Vector3s& p1, const Vector3s& q0, const Vector3s& q1, Scalar& s, Scalar& t)
+    {
+        const Vector3s d1 = p1 - p0, d2 = q1 - q0, r = p0 - q0;
+        const Scalar   a = d1.squaredNorm(), e = d2.squaredNorm(), f = d2.dot(r);
+        const Scalar   c = d1.dot(r), b = d1.dot(d2);
+        const Scalar   denom = a * e - b * b;
+        s                    = denom > std::numeric_limits<Scalar>::epsilon() * a * e ? std::clamp((b * f - c * e) / denom, Scalar(0), Scalar(1)) : 0;
+        t                    = (b * s + f) / e;
+        if (t < 0)
+        {
+            t = 0;
+            s = std::clamp(-c / a, Scalar(0), Scalar(1));
+        }
+        else if (t > 1)
+        {
+            t = 1;
+            s = std::clamp((b - c) / a, Scalar(0), Scalar(1));
+        }
+    }
+
+    void SelfCollision::clear()
+    {
+        m_F.resize(0, 3);
+        m_E.resize(0, 2);
+        m_FE.resize(0, 3);
+        m_edgeFace.clear();
+        m_vertices.clear();
+        m_bvh.clear();
+        m_anchor.resize(0, 3);
+        m_previous.resize(0, 3);
+        m_vertexTriangle.clear();
+        m_edgeEdge.clear();
+        m_contacts.clear();
+    }
+
+    void SelfCollision::build(const MatrixXs& TV, const Eigen::MatrixXi& TT)
+    {
+        PROFILE_PREC("SELF_COLLISION");
+        clear();
+        const int m = static_cast<int>(TT.rows());
+
+        // Boundary faces appear in exactly one tet
+        {
+            static constexpr int kFaces[4][3] = {{1, 2, 3}, {0, 3, 2}, {0, 1, 3}, {0, 2, 1}};
+            std::vector<std::array<int, 4>> faces(4 * static_cast<size_t>(m)); // sorted corners + face id
+            for (int t = 0; t < m; ++t)
+            {
+                for (int k = 0; k < 4; ++k)
+                {
+                    std::array<int, 4>& face = faces[4 * t + k];
+                    for (int c = 0; c < 3; ++c)
+                        face[c] = TT(t, kFaces[k][c]);
+                    std::sort(face.begin(), face.begin() + 3);
+                    face[3] = 4 * t + k;
+                }
+            }
+            std::sort(faces.begin(), faces.end());
+            std::vector<int> boundary;
+            for (size_t i = 0; i < faces.size();)
+            {
+                size_t j = i + 1;
+                while (j < faces.size() && std::equal(faces[i].begin(), faces[i].begin() + 3, faces[j].begin()))
+                    ++j;
+                if (j == i + 1)
+                    boundary.push_back(faces[i][3]);
+                i = j;
+            }
+            std::sort(boundary.begin(), boundary.end());
+            // Oriented away from the opposite corner, the mesher does not fix the sign of the tets
+            m_F.resize(boundary.size(), 3);
+            for (int f = 0; f < static_cast<int>(boundary.size()); ++f)
+            {
+                const int t = boundary[f] / 4;
+                const int k = boundary[f] % 4;
+                for (int c = 0; c < 3; ++c)
+                    m_F(f, c) = TT(t, kFaces[k][c]);
+                const RowVector3s a = TV.row(m_F(f, 0));
+                const RowVector3s b = TV.row(m_F(f, 1));
+                const RowVector3s c = TV.row(m_F(f, 2));
+                if ((b - a).cross(c - a).dot(TV.row(TT(t, k)) - a) > 0)
+                    std::swap(m_F(f, 1), m_F(f, 2));
+            }
+        }
+
+        // Unique edges and their first triangle
+        const int num_faces = static_cast<int>(m_F.rows());
+        {
+            std::vector<std::array<int, 3>> half_edges(3 * static_cast<size_t>(num_faces)); // (min, max, f * 3 + c)
+            for (int f = 0; f < num_faces; ++f)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    int a                 = m_F(f, c);
+                    int b                 = m_F(f, (c + 1) % 3);
+                    half_edges[3 * f + c] = {std::min(a, b), std::max(a, b), 3 * f + c};
+                }
+            }
+            std::sort(half_edges.begin(), half_edges.end());
+            m_FE.resize(num_faces, 3);
+            std::vector<Eigen::Vector2i> edges;
+            for (size_t i = 0; i < half_edges.size(); ++i)
+            {
+                if (i == 0 || half_edges[i][0] != half_edges[i - 1][0] || half_edges[i][1] != half_edges[i - 1][1])
+                {
+                    edges.emplace_back(half_edges[i][0], half_edges[i][1]);
+                    m_edgeFace.push_back(half_edges[i][2] / 3);
+                }
+                m_FE(half_edges[i][2] / 3, half_edges[i][2] % 3) = static_cast<int>(edges.size()) - 1;
+            }
+            m_E.resize(edges.size(), 2);
+            for (int e = 0; e < static_cast<int>(edges.size()); ++e)
+                m_E.row(e) = edges[e].transpose();
+        }
+
+        std::vector<char> on_boundary(TV.rows(), 0);
+        for (int f = 0; f < num_faces; ++f)
+            for (int c = 0; c < 3; ++c)
+                on_boundary[m_F(f, c)] = 1;
+        for (int v = 0; v < TV.rows(); ++v)
+            if (on_boundary[v])
+                m_vertices.push_back(v);
+
+        Scalar mean_edge = 0;
+        for (int e = 0; e < m_E.rows(); ++e)
+            mean_edge += (TV.row(m_E(e, 0)) - TV.row(m_E(e, 1))).norm();
+        mean_edge /= std::max<Eigen::Index>(1, m_E.rows());
+        m_thickness = m_params.thickness > 0 ? m_params.thickness : mean_edge / 10;
+        // The slack trades query frequency against candidate count
+        m_slack = std::max(m_thickness, mean_edge / 4);
+        spdlog::info("Self collision: {} boundary triangles, {} edges, thickness {}", num_faces, m_E.rows(), m_thickness);
+    }
+
+    void SelfCollision::detect(const MatrixXs& q)
+    {
+        m_contacts.clear();
+        if (empty())
+            return;
+        PROFILE_STEP("SELF_COLLISION");
+        const int num_vertices = static_cast<int>(m_vertices.size());
+
+        // Pairs that close in on each other during the step must be contacts at its start, so the contact radius
+        // grows with the surface motion of the last step. The candidate list stays valid while pairs within the
+        // contact radius now were within the query radius at the last query: no vertex moved more than half the
+        // difference since.
+        bool requery = m_anchor.rows() != num_vertices;
+        {
+            PROFILE_STEP("DISPLACEMENT");
+            const bool has_previous = m_previous.rows() == num_vertices;
+            Scalar     motion_sq    = 0;
+            Scalar     drift_sq     = 0;
+            m_previous.resize(num_vertices, 3);
+#pragma omp parallel for reduction(max : motion_sq, drift_sq)
+            for (int i = 0; i < num_vertices; ++i)
+            {
+                const RowVector3s x = q.row(m_vertices[i]);
+                if (has_previous)
+                    motion_sq = std::max(motion_sq, (x - m_previous.row(i)).squaredNorm());
+                if (!requery)
+                    drift_sq = std::max(drift_sq, (x - m_anchor.row(i)).squaredNorm());
+                m_previous.row(i) = x;
+            }
+            m_contactRadius = 2 * m_thickness + std::min(2 * std::sqrt(motion_sq), m_slack);
+            requery         = requery || m_contactRadius + 2 * std::sqrt(drift_sq) > m_queryRadius;
+        }
+        if (requery)
+            broadPhase(q);
+        narrowPhase(q);
+    }
+
+    void SelfCollision::broadPhase(const MatrixXs& q)
+    {
+        PROFILE_STEP("BROAD_PHASE");
+        const int num_vertices = static_cast<int>(m_vertices.size());
+        const int num_faces    = static_cast<int>(m_F.rows());
+        const int num_edges    = static_cast<int>(m_E.rows());
+
+        {
+            PROFILE_STEP("REFIT");
+            m_boxes.resize(num_faces);
+#pragma omp parallel for
+            for (int f = 0; f < num_faces; ++f)
+            {
+                BVH::Box box;
+                for (int c = 0; c < 3; ++c)
+                    box.extend(q.row(m_F(f, c)).transpose());
+                m_boxes[f] = box;
+            }
+            if (m_bvh.empty() || m_refitCount >= kRefitsPerRebuild)
+            {
+                m_bvh.build(m_boxes);
+                m_refitCount = 0;
+            }
+            else
+            {
+                m_bvh.refit(m_boxes);
+                m_refitCount++;
+            }
+        }
+
+        {
+            PROFILE_STEP("QUERY");
+            m_queryRadius = m_contactRadius + m_slack;
+
+            const Scalar                              radius      = m_queryRadius;
+            const int                                 num_threads = omp_get_max_threads();
+            std::vector<std::vector<Eigen::Vector2i>> vt(num_threads), ee(num_threads);
+#pragma omp parallel
+            {
+                PROFILE_STEP("TRAVERSE"); // per thread, shows the imbalance of the static schedule
+                const int tid = omp_get_thread_num();
+#pragma omp for schedule(static) nowait
+                for (int i = 0; i < num_vertices; ++i)
+                {
+                    const int      v = m_vertices[i];
+                    const Vector3s p = q.row(v).transpose();
+                    const BVH::Box query(p.array() - radius, p.array() + radius);
+                    m_bvh.traverse([&](const BVH::Box& box) { return box.intersects(query); },
+                                   [&](int f) {
+                                       if (m_F(f, 0) != v && m_F(f, 1) != v && m_F(f, 2) != v && m_boxes[f].intersects(query))
+                                           vt[tid].emplace_back(v, f);
+                                   });
+                }
+#pragma omp for schedule(static) nowait
+                for (int e = 0; e < num_edges; ++e)
+                {
+                    const int a = m_E(e, 0);
+                    const int b = m_E(e, 1);
+                    BVH::Box  query;
+                    query.extend(q.row(a).transpose());
+                    query.extend(q.row(b).transpose());
+                    query = BVH::Box(query.min().array() - radius, query.max().array() + radius);
+                    m_bvh.traverse([&](const BVH::Box& box) { return box.intersects(query); },
+                                   [&](int f) {
+                                       if (!m_boxes[f].intersects(query))
+                                           return;
+                                       for (int c = 0; c < 3; ++c)
+                                       {
+                                           const int e2 = m_FE(f, c);
+                                           // Every pair once, through the first triangle of the second edge
+                                           if (e2 <= e || m_edgeFace[e2] != f)
+                                               continue;
+                                           const int c2 = m_E(e2, 0);
+                                           const int d2 = m_E(e2, 1);
+                                           if (c2 != a && c2 != b && d2 != a && d2 != b)
+                                               ee[tid].emplace_back(e, e2);
+                                       }
+                                   });
+                }
+            }
+            m_vertexTriangle.clear();
+            m_edgeEdge.clear();
+            for (int tid = 0; tid < num_threads; ++tid)
+            {
+                m_vertexTriangle.insert(m_vertexTriangle.end(), vt[tid].begin(), vt[tid].end());
+                m_edgeEdge.insert(m_edgeEdge.end(), ee[tid].begin(), ee[tid].end());
+            }
+        }
+
+        m_anchor.resize(num_vertices, 3);
+        for (int i = 0; i < num_vertices; ++i)
+            m_anchor.row(i) = q.row(m_vertices[i]);
+        m_numQueries++;
+    }
+
+    // Pairs closer than the contact radius become contacts; they are inequalities, so contacts that are not yet
+    // touching cost nothing
+    void SelfCollision::narrowPhase(const MatrixXs& q)
+    {
+        PROFILE_STEP("NARROW_PHASE");
+        const int                         num_vt      = static_cast<int>(m_vertexTriangle.size());
+        const int                         num_ee      = static_cast<int>(m_edgeEdge.size());
+        const int                         num_threads = omp_get_max_threads();
+        std::vector<std::vector<Contact>> contacts(num_threads);
+#pragma omp parallel
+        {
+            const int tid = omp_get_thread_num();
+#pragma omp for schedule(static) nowait
+            for (int k = 0; k < num_vt; ++k)
+            {
+                const int      v    = m_vertexTriangle[k](0);
+                const int      f    = m_vertexTriangle[k](1);
+                const Vector3s p    = q.row(v).transpose();
+                const Vector3s a    = q.row(m_F(f, 0)).transpose();
+                const Vector3s b    = q.row(m_F(f, 1)).transpose();
+                const Vector3s c    = q.row(m_F(f, 2)).transpose();
+                const Vector3s bary = ClosestPointTriangle(p, a, b, c);
+                const Vector3s d    = p - (bary(0) * a + bary(1) * b + bary(2) * c);
+                const Scalar   dist = d.norm();
+                if (dist >= m_contactRadius)
+                    continue;
+                // Over the interior the outward normal also pushes back vertices that slipped in by less than the
+                // thickness; over edges and corners only vertices in front count, with the direction to the closest
+                // point. This never flips a contact inside out.
+                Vector3s     n        = (b - a).cross(c - a);
+                const Scalar n_norm   = n.norm();
+                const Scalar eps      = Scalar(1e-4);
+                const bool   interior = (bary.array() > eps).all();
+                if (n_norm <= 0)
+                    continue;
+                n /= n_norm;
+                const Scalar height = n.dot(d);
+                if (interior ? height <= -m_thickness : height <= 0)
+                    continue;
+                if (!interior)
+                    n = d / dist;
+                Contact contact;
+                contact.vertices << v, m_F(f, 0), m_F(f, 1), m_F(f, 2);
+                contact.weights << 1, -bary(0), -bary(1), -bary(2);
+                contact.normal = n;
+                contacts[tid].push_back(contact);
+            }
+#pragma omp for schedule(static)
+            for (int k = 0; k < num_ee; ++k)
+            {
+                const Eigen::Vector2i e0 = m_E.row(m_edgeEdge[k](0)).transpose();
+                const Eigen::Vector2i e1 = m_E.row(m_edgeEdge[k](1)).transpose();
+                const Vector3s        p0 = q.row(e0(0)).transpose();
+                const Vector3s        p1 = q.row(e0(1)).transpose();
+                const Vector3s        q0 = q.row(e1(0)).transpose();
+                const Vector3s        q1 = q.row(e1(1)).transpose();
+                Scalar                s, t;
+                ClosestSegmentSegment(p0, p1, q0, q1, s, t);
+                // Endpoint contacts are vertex-triangle contacts of a neighboring triangle
+                const Scalar eps = Scalar(1e-3);
+                if (s <= eps || s >= 1 - eps || t <= eps || t >= 1 - eps)
+                    continue;
+                const Vector3s d    = (p0 + s * (p1 - p0)) - (q0 + t * (q1 - q0));
+                const Scalar   dist = d.norm();
+                if (dist >= m_contactRadius || dist <= std::numeric_limits<Scalar>::epsilon() * m_thickness)
+                    continue;
+                Contact contact;
+                contact.vertices << e0(0), e0(1), e1(0), e1(1);
+                contact.weights << 1 - s, s, -(1 - t), -t;
+                contact.normal = d / dist;
+                contacts[tid].push_back(contact);
+            }
+        }
+        for (int tid = 0; tid < num_threads; ++tid)
+            m_contacts.insert(m_contacts.end(), contacts[tid].begin(), contacts[tid].end());
+    }
+
+    int SelfCollision::solveContacts(MatrixXs& q, const VectorXs& inv_mass) const
+    {
+        // Contacts share vertices and are few compared to the tets, a sequential sweep is cheap
+        int violated = 0;
+        for (const Contact& contact : m_contacts)
+        {
+            Scalar C     = -m_thickness;
+            Scalar denom = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                const int v = contact.vertices(i);
+                C += contact.weights(i) * contact.normal.dot(q.row(v).transpose());
+                denom += contact.weights(i) * contact.weights(i) * inv_mass(v);
+            }
+            if (C >= 0 || denom <= 0)
+                continue;
+            violated++;
+            const Scalar dlambda = -C / denom;
+            for (int i = 0; i < 4; ++i)
+            {
+                const int v = contact.vertices(i);
+                q.row(v) += (inv_mass(v) * contact.weights(i) * dlambda) * contact.normal.transpose();
+            }
+        }
+        return violated;
+    }
+
+} // namespace FS
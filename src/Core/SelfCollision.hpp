@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Core/BVH.hpp"
+#include "Core/Scalar.hpp"
+
+#include <Eigen/Core>
+
+#include <algorithm>
+#include <vector>
+
+namespace FS
+{
+
+    struct CollisionParams
+    {
+        bool   enabled    = false;
+        Scalar thickness  = 0; // contact distance in mesh units, 0 picks a tenth of the mean surface edge length
+        int    iterations = 4; // contact passes per PD step / XPBD sweep
+    };
+
+    // Linear contact constraint n . sum_i w_i x_i >= thickness on four tet vertices.
+    // Vertex-triangle: w = (1, -b0, -b1, -b2), edge-edge: w = (1 - s, s, -(1 - t), -t).
+    struct Contact
+    {
+        Eigen::Vector4i             vertices;
+        Eigen::Matrix<Scalar, 4, 1> weights;
+        Vector3s                    normal;
+    };
+
+    // Self-collision of the boundary of the tet mesh, so contacts act directly on simulation vertices.
+    //   broad phase:  a refittable BVH over the boundary triangles is queried with the inflated boxes of every
+    //                 surface vertex (vertex-triangle) and edge (edge-edge). The candidate pairs are kept as a
+    //                 Verlet list: the query radius carries a slack, and the list is reused until some vertex has
+    //                 moved more than half the slack since the last query. Most of the face barely moves relative
+    //                 to itself, so the query runs only every few steps; the tree is refit and rebuilt rarely.
+    //                 The contact radius grows with the motion of the last step so fast pairs do not tunnel.
+    //   narrow phase: exact point-triangle and segment-segment distances of the candidates, every step, in parallel.
+    // Contacts are detected on the positions at the start of a step with fixed normals; XPBD solves them in every
+    // sweep, PD adds them as projective constraints on the vertices in contact (see PDSolver::SetContactVertices).
+    struct SelfCollision
+    {
+        CollisionParams m_params;
+
+        Eigen::MatrixXi  m_F;         // boundary triangles of the tets, oriented outwards
+        Eigen::MatrixXi  m_E;         // unique boundary edges
+        Eigen::MatrixXi  m_FE;        // edges of every boundary triangle
+        std::vector<int> m_edgeFace;  // first triangle of every edge, deduplicates edge-edge pairs
+        std::vector<int> m_vertices;  // tet vertices on the boundary
+        Scalar           m_thickness     = 0;
+        Scalar           m_slack         = 0; // extra query radius that keeps the candidate list valid for a while
+        Scalar           m_contactRadius = 0; // 2 * thickness plus the surface motion of the last step
+        Scalar           m_queryRadius   = 0; // contact radius + slack at the last query
+
+        BVH                   m_bvh;
+        std::vector<BVH::Box> m_boxes;
+        MatrixXs              m_anchor;         // positions of m_vertices at the last broad phase
+        MatrixXs              m_previous;       // positions of m_vertices at the last detect()
+        int                   m_refitCount = 0; // refits since the last rebuild
+        int                   m_numQueries = 0; // broad phases run, for the UI
+
+        std::vector<Eigen::Vector2i> m_vertexTriangle; // candidate (vertex, triangle) pairs
+        std::vector<Eigen::Vector2i> m_edgeEdge;       // candidate (edge, edge) pairs
+        std::vector<Contact>         m_contacts;
+
+    public:
+        // Extracts the boundary of the tet mesh, recorded in g_PreComputeProfiler
+        void build(const MatrixXs& TV, const Eigen::MatrixXi& TT);
+        void clear();
+        // Broad and narrow phase on the tet vertex positions `q`, recorded in g_StepProfiler
+        void detect(const MatrixXs& q);
+        // One Gauss-Seidel pass over the contacts, pins have zero inverse mass. Returns the violated contacts.
+        int solveContacts(MatrixXs& q, const VectorXs& inv_mass) const;
+
+        // Changes the contact distance, the candidate list is requeried at the next detect()
+        void setThickness(Scalar thickness)
+        {
+            m_thickness = thickness;
+            m_anchor.resize(0, 3);
+        }
+
+        bool empty() const { return m_F.rows() == 0; }
+        int  numContacts() const { return static_cast<int>(m_contacts.size()); }
+        // Sorted tet vertices of the current contacts, reusing the capacity of `vertices`
+        void contactVertices(std::vector<int>& vertices) const
+        {
+            vertices.clear();
+            for (const Contact& c : m_contacts)
+                vertices.insert(vertices.end(), c.vertices.data(), c.vertices.data() + 4);
+            std::sort(vertices.begin(), vertices.end());
+            vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        }
+
+    private:
+        void broadPhase(const MatrixXs& q);
+        void narrowPhase(const MatrixXs& q);
+    };
+
+} // namespace FS
@@ -0,0 +1,253 @@
+#include "Core/Simulator.hpp"
+
+#include "Util/Profiler.hpp"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace FS
+{
+
+    void Simulator::Setup(const VertexBufferS& V, const Eigen::MatrixXi& F)
+    {
+        PROFILE_PREC("PRECOMPUTE");
+        m_restV      = V;
+        m_F          = F;
+        m_numSteps   = 0;
+        m_dragVertex = -1;
+
+        {
+            PROFILE_PREC("TETRAHEDRALIZE");
+            const bool      use_cage = m_cageV.rows() > 0 && m_cageF.rows() > 0;
+            Eigen::MatrixXd SV       = use_cage ? Eigen::MatrixXd(m_cageV.cast<double>()) : V.toMatrix<double>();
+            const auto&     SF       = use_cage ? m_cageF : F;
+            Eigen::MatrixXd TV;
+            bool            success = Tetrahedralize(SV, SF, m_tetParams, TV, m_TT, m_tetCacheURL);
+            if (!success && !m_tetParams.carve)
+            {
+                // Open scans are not valid PLCs for TetGen
+                spdlog::warn("Retrying by carving the convex hull with the winding number");
+                TetParams carve_params = m_tetParams;
+                carve_params.carve     = true;
+                success                = Tetrahedralize(SV, SF, carve_params, TV, m_TT, m_tetCacheURL);
+            }
+            if (!success || TV.rows() == 0)
+            {
+                spdlog::error("Tetrahedralization failed, simulation disabled");
+                m_TV.resize(0, 3);
+                m_TT.resize(0, 4);
+                m_collision.clear();
+                m_solver.m_isReady = false;
+                m_xpbd.m_isReady   = false;
+                return;
+            }
+            m_TV = TV.cast<Scalar>();
+        }
+
+        {
+            PROFILE_PREC("EMBEDDING");
+            m_embedding.build(V, m_TV, m_TT);
+        }
+
+        {
+            PROFILE_PREC("MUSCLES");
+            m_rig.assign(m_TV, m_TT);
+        }
+
+        m_collision.build(m_TV, m_TT);
+
+        m_pins.clear();
+        m_jawVertex.assign(m_TV.rows(), 0);
+        if (m_rig.hasAttachments())
+        {
+            // Tissue attached to the skull stays put, tissue attached to the jaw follows it
+            for (int v = 0; v < m_TV.rows(); ++v)
+            {
+                const Vector3s p     = m_TV.row(v).transpose();
+                auto           in_any = [&](const std::vector<RigRegion>& regions) {
+                    return std::any_of(regions.begin(), regions.end(), [&](const RigRegion& r) { return r.contains(p); });
+                };
+                if (in_any(m_rig.m_jaw.regions))
+                    m_jawVertex[v] = 1;
+                if (m_jawVertex[v] || in_any(m_rig.m_skull))
+                    m_pins.push_back(v);
+            }
+        }
+        else
+        {
+            // Pin the top slab of the volume
+            Scalar max_y  = m_TV.col(1).maxCoeff();
+            Scalar height = max_y - m_TV.col(1).minCoeff();
+            for (int v = 0; v < m_TV.rows(); ++v)
+            {
+                if (m_TV(v, 1) >= max_y - m_pinHeight * height)
+                    m_pins.push_back(v);
+            }
+        }
+        if (m_pins.empty())
+            spdlog::warn("No tet vertex is attached, the volume will fall");
+        SetupSolver();
+        spdlog::info("Simulator setup: {} surface vertices, {} tet vertices, {} tets", V.rows(), m_TV.rows(), m_TT.rows());
+    }
+
+    void Simulator::Step(VertexBufferS& V)
+    {
+        if (!IsReady())
+            return;
+        PROFILE_STEP("STEP");
+        UpdateJawTargets();
+        // Contacts are detected at the start of the step, the solvers keep them from closing during it
+        const SelfCollision* collision = m_collision.m_params.enabled && !m_collision.empty() ? &m_collision : nullptr;
+        if (collision)
+            m_collision.detect(Positions());
+        m_solver.m_collision = collision;
+        m_xpbd.m_collision   = collision;
+        if (m_solverType == SolverType::PD)
+        {
+            // Only the vertices in contact are weighted, the rest of the skin moves freely
+            if (collision)
+                m_collision.contactVertices(m_contactVertices);
+            else
+                m_contactVertices.clear();
+            if (m_contactVertices != m_solver.m_contactVertices)
+            {
+                PROFILE_PREC("PRECOMPUTE");
+                m_solver.SetContactVertices(m_contactVertices);
+            }
+            m_solver.Step();
+        }
+        else
+            m_xpbd.Step();
+        m_numSteps++;
+
+        {
+            PROFILE_STEP("EMBEDDING");
+            m_embedding.apply(Positions(), V);
+        }
+    }
+
+    void Simulator::Reset(VertexBufferS& V)
+    {
+        EndDrag();
+        V          = m_restV;
+        m_numSteps = 0;
+        m_solver.Reset();
+        m_xpbd.Reset();
+    }
+
+    void Simulator::SetSolverType(SolverType type)
+    {
+        if (type == m_solverType)
+            return;
+        m_solverType = type;
+        if (m_TT.rows() > 0)
+        {
+            PROFILE_PREC("PRECOMPUTE");
+            SetupSolver();
+        }
+    }
+
+    bool Simulator::TogglePin(int surface_vertex)
+    {
+        if (!IsReady() || surface_vertex < 0 || surface_vertex >= m_embedding.rows())
+            return false;
+        PROFILE_PREC("PRECOMPUTE");
+        const int v  = m_embedding.dominantTetVertex(surface_vertex);
+        auto      it = std::find(m_pins.begin(), m_pins.end(), v);
+        bool      success;
+        if (it == m_pins.end())
+        {
+            const RowVector3s target = Positions().row(v);
+            success = m_solverType == SolverType::PD ? m_solver.AddPin(v, target) : m_xpbd.AddPin(v, target);
+            if (success)
+                m_pins.push_back(v);
+        }
+        else
+        {
+            success = m_solverType == SolverType::PD ? m_solver.RemovePin(v) : m_xpbd.RemovePin(v);
+            if (success)
+                m_pins.erase(it);
+        }
+        return success;
+    }
+
+    bool Simulator::IsPinned(int surface_vertex) const
+    {
+        if (surface_vertex < 0 || surface_vertex >= m_embedding.rows())
+            return false;
+        return std::find(m_pins.begin(), m_pins.end(), m_embedding.dominantTetVertex(surface_vertex)) != m_pins.end();
+    }
+
+    bool Simulator::BeginDrag(int surface_vertex)
+    {
+        EndDrag();
+        if (!IsReady() || surface_vertex < 0 || surface_vertex >= m_embedding.rows())
+            return false;
+        PROFILE_PREC("PRECOMPUTE");
+        // The surface vertex is interpolated, keep the offset so the grab does not jump
+        const MatrixXs& q       = Positions();
+        RowVector3s     surface = RowVector3s::Zero();
+        for (int c = 0; c < 4; ++c)
+            surface += m_embedding.m_weights(surface_vertex, c) * q.row(m_embedding.m_indices(surface_vertex, c));
+        const int  v       = m_embedding.dominantTetVertex(surface_vertex);
+        const bool success = m_solverType == SolverType::PD ? m_solver.SetDrag(v, q.row(v)) : m_xpbd.SetDrag(v, q.row(v));
+        if (!success)
+            return false;
+        m_dragVertex = v;
+        m_dragOffset = q.row(v) - surface;
+        return true;
+    }
+
+    void Simulator::DragTo(const Vector3s& target)
+    {
+        if (m_dragVertex < 0)
+            return;
+        const RowVector3s tet_target = target.transpose() + m_dragOffset;
+        if (m_solverType == SolverType::PD)
+            m_solver.SetDrag(m_dragVertex, tet_target);
+        else
+            m_xpbd.SetDrag(m_dragVertex, tet_target);
+    }
+
+    void Simulator::EndDrag()
+    {
+        if (m_dragVertex < 0)
+            return;
+        PROFILE_PREC("PRECOMPUTE");
+        m_solver.ClearDrag();
+        m_xpbd.ClearDrag();
+        m_dragVertex = -1;
+    }
+
+    void Simulator::UpdateJawTargets()
+    {
+        if (m_rig.m_jaw.regions.empty())
+            return;
+        auto update = [&](const std::vector<int>& pins, MatrixXs& targets) {
+            for (int i = 0; i < static_cast<int>(pins.size()); ++i)
+            {
+                if (m_jawVertex[pins[i]])
+                    targets.row(i) = m_rig.m_jaw.transform(m_TV.row(pins[i]).transpose()).transpose();
+            }
+        };
+        if (m_solverType == SolverType::PD)
+            update(m_solver.m_pins, m_solver.m_pinTargets);
+        else
+            update(m_xpbd.m_pins, m_xpbd.m_pinTargets);
+    }
+
+    void Simulator::SetupSolver()
+    {
+        m_dragVertex = -1;
+        // Only the active solver is set up, the PD factorization is not free
+        m_solver.m_isReady = false;
+        m_xpbd.m_isReady   = false;
+        m_solver.m_rig     = &m_rig;
+        m_xpbd.m_rig       = &m_rig;
+        if (m_solverType == SolverType::PD)
+            m_solver.Setup(m_TV, m_TT, m_pins);
+        else
+            m_xpbd.Setup(m_TV, m_TT, m_pins);
+    }
+
+} // namespace FS
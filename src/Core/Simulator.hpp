@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Core/Embedding.hpp"
+#include "Core/MuscleRig.hpp"
+#include "Core/PDSolver.hpp"
+#include "Core/Scalar.hpp"
+#include "Core/SelfCollision.hpp"
+#include "Core/Tetrahedralize.hpp"
+#include "Core/VertexBuffer.hpp"
+#include "Core/XPBDSolver.hpp"
+
+#include <Eigen/Core>
+
+#include <string>
+
+namespace FS
+{
+
+    enum class SolverType
+    {
+        PD,   // prefactored Projective Dynamics, converged and stable
+        XPBD, // graph-colored Gauss-Seidel XPBD, cheap interactive preview
+    };
+
+    // Owns the simulation state independent of any window or GL context. The viewer and the headless
+    // runner both drive it through Setup/Step/Reset and read the deformed positions back from `V`.
+    struct Simulator
+    {
+        VertexBufferS   m_restV;
+        Eigen::MatrixXi m_F;
+
+        // Optional coarse surface to simulate instead of the render surface, e.g. a decimated skin
+        MatrixXs        m_cageV;
+        Eigen::MatrixXi m_cageF;
+
+        // Volumetric simulation mesh and the embedding of the render surface in it
+        TetParams       m_tetParams;
+        std::string     m_tetCacheURL; // empty disables the tet cache
+        MatrixXs        m_TV;
+        Eigen::MatrixXi m_TT;
+        Embedding       m_embedding;
+
+        // Active material, assigned to the tets in Setup; activations are read by the solvers every step
+        MuscleRig m_rig;
+
+        // Self-collision of the tet boundary (lips, eyelids), off by default
+        SelfCollision    m_collision;
+        std::vector<int> m_contactVertices; // tet vertices of the current contacts, weighted in the PD system
+
+        SolverType       m_solverType = SolverType::PD;
+        PDSolver         m_solver;
+        XPBDSolver       m_xpbd;
+        std::vector<int>  m_pins;      // tet vertices
+        std::vector<char> m_jawVertex; // per tet vertex, pinned to the jaw
+
+        // Mouse drag: a soft spring on the tet vertex carrying the grabbed surface vertex
+        int         m_dragVertex = -1;
+        RowVector3s m_dragOffset = RowVector3s::Zero(); // tet vertex - surface vertex at grab time
+
+        int    m_numSteps  = 0;
+        Scalar m_pinHeight = Scalar(0.05); // without rig attachments, the top fraction of the bounding box is pinned
+
+    public:
+        // Precomputation for a new mesh, recorded in g_PreComputeProfiler
+        void Setup(const VertexBufferS& V, const Eigen::MatrixXi& F);
+        // Advances `V` by one time step, recorded in g_StepProfiler
+        void Step(VertexBufferS& V);
+        // Restores the rest positions
+        void Reset(VertexBufferS& V);
+
+        // Switches the solver, the new one is set up on the current tets
+        void SetSolverType(SolverType type);
+        // Pins the tet vertex carrying `surface_vertex` where it currently is, or releases it. No refactorization.
+        bool TogglePin(int surface_vertex);
+        bool IsPinned(int surface_vertex) const;
+        int  NumPins() const { return static_cast<int>(m_pins.size()); }
+
+        // Grabs `surface_vertex`, pulls it towards `target` and releases it. Moving the target is a right-hand
+        // side change for both solvers; only grabbing a new vertex touches the PD factor (rank-one update).
+        bool BeginDrag(int surface_vertex);
+        void DragTo(const Vector3s& target);
+        void EndDrag();
+        bool IsDragging() const { return m_dragVertex >= 0; }
+
+        bool            IsReady() const { return m_solverType == SolverType::PD ? m_solver.m_isReady : m_xpbd.m_isReady; }
+        const MatrixXs& Positions() const { return m_solverType == SolverType::PD ? m_solver.Positions() : m_xpbd.Positions(); }
+
+    private:
+        void SetupSolver();
+        // Moves the targets of the jaw pins with the current jaw angle
+        void UpdateJawTargets();
+    };
+
+} // namespace FS
@@ -0,0 +1,213 @@
+#include "Core/SparseCholesky.hpp"
+
+#include <Eigen/OrderingMethods>
+
+#include <algorithm>
+#include <cmath>
+
+namespace FS
+{
+
+    bool SparseCholesky::compute(const SparseMatrixS& A)
+    {
+        m_isReady   = false;
+        m_n         = static_cast<int>(A.rows());
+        const int n = m_n;
+
+        // AMD on the pattern of A, Eigen returns the inverse permutation (new -> old)
+        Eigen::AMDOrdering<int>                                       ordering;
+        Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> perm_inv;
+        ordering(A, perm_inv);
+        m_perm.resize(n);
+        m_permInv.resize(n);
+        for (int k = 0; k < n; ++k)
+        {
+            m_perm[k]            = perm_inv.indices()[k];
+            m_permInv[m_perm[k]] = k;
+        }
+
+        // Elimination tree and column counts of L for P A P^T (ldl_symbolic)
+        m_parent.assign(n, -1);
+        std::vector<int> flag(n), lnz(n, 0);
+        for (int k = 0; k < n; ++k)
+        {
+            flag[k] = k;
+            for (SparseMatrixS::InnerIterator it(A, m_perm[k]); it; ++it)
+            {
+                for (int i = m_permInv[it.row()]; i < k && flag[i] != k; i = m_parent[i])
+                {
+                    if (m_parent[i] == -1)
+                        m_parent[i] = k;
+                    lnz[i]++;
+                    flag[i] = k;
+                }
+            }
+        }
+        m_Lp.assign(n + 1, 0);
+        for (int k = 0; k < n; ++k)
+            m_Lp[k + 1] = m_Lp[k] + lnz[k];
+        m_Li.resize(m_Lp[n]);
+        m_Lx.resize(m_Lp[n]);
+        m_D.resize(n);
+        return factorize(A);
+    }
+
+    bool SparseCholesky::factorize(const SparseMatrixS& A)
+    {
+        m_isReady   = false;
+        const int n = m_n;
+        if (A.rows() != n || A.cols() != n)
+            return false;
+
+        // Up-looking: row k of L from a sparse triangular solve along the elimination tree (ldl_numeric)
+        std::vector<Scalar> y(n, 0);
+        std::vector<int>    pattern(n), flag(n), lnz(n, 0);
+        for (int k = 0; k < n; ++k)
+        {
+            int top = n;
+            flag[k] = k;
+            for (SparseMatrixS::InnerIterator it(A, m_perm[k]); it; ++it)
+            {
+                int i = m_permInv[it.row()];
+                if (i > k)
+                    continue;
+                y[i] += it.value();
+                int len = 0;
+                for (; flag[i] != k; i = m_parent[i])
+                {
+                    pattern[len++] = i;
+                    flag[i]        = k;
+                }
+                while (len > 0)
+                    pattern[--top] = pattern[--len];
+            }
+            m_D[k] = y[k];
+            y[k]   = 0;
+            for (; top < n; ++top)
+            {
+                int    i  = pattern[top];
+                Scalar yi = y[i];
+                y[i]      = 0;
+                int p     = m_Lp[i];
+                int p_end = p + lnz[i];
+                for (; p < p_end; ++p)
+                    y[m_Li[p]] -= m_Lx[p] * yi;
+                Scalar l_ki = yi / m_D[i];
+                m_D[k] -= l_ki * yi;
+                m_Li[p] = k;
+                m_Lx[p] = l_ki;
+                lnz[i]++;
+            }
+            if (!(m_D[k] > 0))
+                return false; // not positive definite
+        }
+        m_isReady = true;
+        return true;
+    }
+
+    // Forward/diagonal/backward substitution on a row-major n x C block, every L entry is applied to all C
+    // right-hand sides at once. C is a template parameter for the common 3-column case.
+    template<int C>
+    static void SubstituteRows(int                        n,
+                               int                        cols,
+                               const std::vector<int>&    Lp,
+                               const std::vector<int>&    Li,
+                               const std::vector<Scalar>& Lx,
+                               const std::vector<Scalar>& D,
+                               Scalar*                    y)
+    {
+        const int stride = C > 0 ? C : cols;
+        for (int j = 0; j < n; ++j)
+        {
+            const Scalar* yj = y + j * stride;
+            for (int p = Lp[j]; p < Lp[j + 1]; ++p)
+            {
+                Scalar* yi = y + Li[p] * stride;
+                for (int c = 0; c < stride; ++c)
+                    yi[c] -= Lx[p] * yj[c];
+            }
+        }
+        for (int j = 0; j < n; ++j)
+            for (int c = 0; c < stride; ++c)
+                y[j * stride + c] /= D[j];
+        for (int j = n - 1; j >= 0; --j)
+        {
+            Scalar* yj = y + j * stride;
+            for (int p = Lp[j]; p < Lp[j + 1]; ++p)
+            {
+                const Scalar* yi = y + Li[p] * stride;
+                for (int c = 0; c < stride; ++c)
+                    yj[c] -= Lx[p] * yi[c];
+            }
+        }
+    }
+
+    void SparseCholesky::solveInPlace(MatrixXs& B) const
+    {
+        const int n    = m_n;
+        const int cols = static_cast<int>(B.cols());
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> Y(n, cols);
+        for (int k = 0; k < n; ++k)
+            Y.row(k) = B.row(m_perm[k]);
+        if (cols == 3)
+            SubstituteRows<3>(n, cols, m_Lp, m_Li, m_Lx, m_D, Y.data());
+        else
+            SubstituteRows<0>(n, cols, m_Lp, m_Li, m_Lx, m_D, Y.data());
+        for (int k = 0; k < n; ++k)
+            B.row(m_perm[k]) = Y.row(k);
+    }
+
+    bool SparseCholesky::updateDiagonal(int i, Scalar sigma)
+    {
+        if (!m_isReady || i < 0 || i >= m_n)
+            return false;
+
+        // Rank-one LDL^T update (Gill, Golub, Murray and Saunders, method C1) restricted to the path from i to the
+        // root of the elimination tree, which is where the nonzeros of L^-1 e_i are. The touched columns are saved
+        // so that a failing downdate can be rolled back.
+        struct Saved
+        {
+            int    column;
+            Scalar d;
+        };
+        std::vector<Saved>  saved;
+        std::vector<Scalar> saved_Lx;
+        std::vector<Scalar> w(m_n, 0);
+        const int           start = m_permInv[i];
+        w[start]                  = std::sqrt(std::abs(sigma));
+        Scalar alpha              = sigma < 0 ? Scalar(-1) : Scalar(1);
+        for (int j = start; j != -1; j = m_parent[j])
+        {
+            saved.push_back({j, m_D[j]});
+            saved_Lx.insert(saved_Lx.end(), m_Lx.begin() + m_Lp[j], m_Lx.begin() + m_Lp[j + 1]);
+
+            Scalar wj = w[j];
+            w[j]      = 0;
+            Scalar d  = m_D[j];
+            m_D[j]    = d + alpha * wj * wj;
+            if (!(m_D[j] > 0))
+            {
+                size_t offset = 0;
+                for (const Saved& s : saved)
+                {
+                    m_D[s.column] = s.d;
+                    std::copy(saved_Lx.begin() + offset,
+                              saved_Lx.begin() + offset + (m_Lp[s.column + 1] - m_Lp[s.column]),
+                              m_Lx.begin() + m_Lp[s.column]);
+                    offset += m_Lp[s.column + 1] - m_Lp[s.column];
+                }
+                return false;
+            }
+            Scalar beta = wj * alpha / m_D[j];
+            alpha       = alpha * d / m_D[j];
+            for (int p = m_Lp[j]; p < m_Lp[j + 1]; ++p)
+            {
+                int r = m_Li[p];
+                w[r] -= wj * m_Lx[p];
+                m_Lx[p] += beta * w[r];
+            }
+        }
+        return true;
+    }
+
+} // namespace FS
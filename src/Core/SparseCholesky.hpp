@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Core/Scalar.hpp"
+
+#include <Eigen/Sparse>
+
+#include <vector>
+
+namespace FS
+{
+
+    // Sparse LDL^T factorization of a symmetric positive definite matrix with a fill-reducing (AMD) ordering,
+    // up-looking as in Davis' LDL. Unlike Eigen::SimplicialLDLT the factor is owned here, so it supports
+    // rank-one updates and downdates of the diagonal, A +- sigma e_i e_i^T, in O(|path to the etree root|)
+    // instead of a refactorization. Adding to a diagonal entry never changes the pattern of A, so the pattern
+    // of L stays valid.
+    struct SparseCholesky
+    {
+        using SparseMatrixS = Eigen::SparseMatrix<Scalar>;
+
+        // Symbolic analysis (ordering, elimination tree, column counts) and numeric factorization.
+        // `A` holds both triangles.
+        bool compute(const SparseMatrixS& A);
+        // Numeric factorization of a matrix with the pattern of the last compute()
+        bool factorize(const SparseMatrixS& A);
+
+        // Solves A X = B for every column of B, in place
+        void solveInPlace(MatrixXs& B) const;
+        MatrixXs solve(const MatrixXs& B) const
+        {
+            MatrixXs X = B;
+            solveInPlace(X);
+            return X;
+        }
+
+        // Factor of A + sigma e_i e_i^T. False if a downdate would make the matrix indefinite, the factor is
+        // then unchanged.
+        bool updateDiagonal(int i, Scalar sigma);
+
+        bool isReady() const { return m_isReady; }
+        int  rows() const { return m_n; }
+        int  nonZerosL() const { return static_cast<int>(m_Li.size()); }
+
+    private:
+        int  m_n       = 0;
+        bool m_isReady = false;
+
+        std::vector<int>    m_perm;    // new -> old index
+        std::vector<int>    m_permInv; // old -> new index
+        std::vector<int>    m_parent;  // elimination tree, -1 at roots
+        std::vector<int>    m_Lp;      // column pointers of the strictly lower L (CSC)
+        std::vector<int>    m_Li;      // row indices, increasing within a column
+        std::vector<Scalar> m_Lx;
+        std::vector<Scalar> m_D;
+    };
+
+} // namespace FS
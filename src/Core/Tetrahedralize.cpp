@@ -0,0 +1,132 @@
+#include "Core/Tetrahedralize.hpp"
+
+#include "Core/FastWindingNumber.hpp"
+#include "Util/MeshCache.hpp"
+
+#include <igl/copyleft/tetgen/tetrahedralize.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace FS
+{
+
+    std::string TetSwitches(const TetParams& params)
+    {
+        // p: PLC input, q: radius-edge bound, a: volume bound, Y: no Steiner points on the surface, Q: quiet.
+        // Carving meshes the point set only, the facets are not constraints.
+        std::string switches = fmt::format("{}q{}", params.carve ? "" : "p", params.radius_edge_ratio);
+        if (params.max_volume > 0 && std::isfinite(params.max_volume))
+        {
+            // Fixed notation, TetGen does not parse exponents everywhere. 17 significant digits keep tiny bounds
+            // from rounding to 0 and distinct bounds from sharing a cache key.
+            const int decimals = std::max(0, 16 - static_cast<int>(std::floor(std::log10(params.max_volume))));
+            switches += fmt::format("a{:.{}f}", params.max_volume, decimals);
+        }
+        else if (params.max_volume != 0)
+            spdlog::warn("Ignoring the tet volume bound {}", params.max_volume);
+        if (params.preserve_surface && !params.carve)
+            switches += "Y";
+        return switches + "Q";
+    }
+
+    // Keeps the tets inside (V, F) and drops the vertices only used by removed tets, input vertices keep their index
+    static void CarveTets(const Eigen::MatrixXd& V,
+                          const Eigen::MatrixXi& F,
+                          const TetParams&       params,
+                          Eigen::MatrixXd&       TV,
+                          Eigen::MatrixXi&       TT)
+    {
+        const int num_tets = static_cast<int>(TT.rows());
+        MatrixXs  barycenters(num_tets, 3);
+#pragma omp parallel for
+        for (int t = 0; t < num_tets; ++t)
+        {
+            barycenters.row(t) = ((TV.row(TT(t, 0)) + TV.row(TT(t, 1)) + TV.row(TT(t, 2)) + TV.row(TT(t, 3))) / 4).cast<Scalar>();
+        }
+        FastWindingNumber fwn;
+        fwn.m_beta = static_cast<Scalar>(params.winding_beta);
+        fwn.build(V.cast<Scalar>(), F);
+        VectorXs W;
+        fwn.query(barycenters, W);
+
+        std::vector<int> remap(TV.rows(), -1);
+        for (int v = 0; v < V.rows(); ++v)
+            remap[v] = v;
+        int             num_kept_tets = 0;
+        int             num_verts     = static_cast<int>(V.rows());
+        Eigen::MatrixXi kept((W.array() > params.winding_threshold).count(), 4);
+        for (int t = 0; t < num_tets; ++t)
+        {
+            if (W(t) <= params.winding_threshold)
+                continue;
+            for (int c = 0; c < 4; ++c)
+            {
+                int& v = remap[TT(t, c)];
+                if (v < 0)
+                    v = num_verts++;
+                kept(num_kept_tets, c) = v;
+            }
+            num_kept_tets++;
+        }
+        Eigen::MatrixXd kept_verts(num_verts, 3);
+        for (int v = 0; v < static_cast<int>(remap.size()); ++v)
+        {
+            if (remap[v] >= 0)
+                kept_verts.row(remap[v]) = TV.row(v);
+        }
+        spdlog::info("Carved {} of {} tets by winding number", num_kept_tets, num_tets);
+        TV = std::move(kept_verts);
+        TT = std::move(kept);
+    }
+
+    bool Tetrahedralize(const Eigen::MatrixXd& V,
+                        const Eigen::MatrixXi& F,
+                        const TetParams&       params,
+                        Eigen::MatrixXd&       TV,
+                        Eigen::MatrixXi&       TT,
+                        const std::string&     cache_url)
+    {
+        auto begin_time = std::chrono::steady_clock::now();
+        auto elapsed_ms = [&begin_time]() {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin_time).count();
+        };
+        const std::string switches = TetSwitches(params);
+
+        uint64_t cache_key = 0;
+        if (!cache_url.empty())
+        {
+            cache_key = Util::hashBytes(V.data(), V.size() * sizeof(double));
+            cache_key = Util::hashCombine(cache_key, Util::hashBytes(F.data(), F.size() * sizeof(int)));
+            cache_key = Util::hashCombine(cache_key, Util::hashBytes(switches.data(), switches.size()));
+            if (params.carve)
+            {
+                cache_key = Util::hashCombine(cache_key, std::hash<double>()(params.winding_threshold));
+                cache_key = Util::hashCombine(cache_key, std::hash<double>()(params.winding_beta));
+            }
+            if (Util::loadCache(cache_url, cache_key, TV, TT))
+            {
+                spdlog::info("Tets loaded: {} vertices, {} tets in {:.2f} ms (from {})", TV.rows(), TT.rows(), elapsed_ms(), cache_url);
+                return true;
+            }
+        }
+
+        Eigen::MatrixXi TF;
+        int             status = igl::copyleft::tetgen::tetrahedralize(V, F, switches, TV, TT, TF);
+        if (status != 0)
+        {
+            spdlog::error("TetGen failed with status {} (switches \"{}\")", status, switches);
+            return false;
+        }
+        if (params.carve)
+            CarveTets(V, F, params, TV, TT);
+        spdlog::info("Tetrahedralized with \"{}\": {} vertices, {} tets in {:.2f} ms", switches, TV.rows(), TT.rows(), elapsed_ms());
+
+        if (!cache_url.empty())
+            Util::storeCache(cache_url, cache_key, TV, TT);
+        return true;
+    }
+
+} // namespace FS
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <string>
+
+namespace FS
+{
+
+    struct TetParams
+    {
+        double max_volume        = 0.0;   // upper bound of the tet volume in mesh units, 0 = unbounded
+        double radius_edge_ratio = 1.414; // quality bound, smaller gives rounder tets and more of them
+        bool   preserve_surface  = true;  // keep the input surface so its vertices stay the first rows of TV
+
+        // Carving mode for open or self-intersecting surfaces: mesh the convex hull of the vertices and keep the
+        // tets whose barycenter has a winding number above the threshold (FastWindingNumber with `winding_beta`)
+        bool   carve             = false;
+        double winding_threshold = 0.5;
+        double winding_beta      = 2.0;
+    };
+
+    // TetGen switches for the parameters
+    std::string TetSwitches(const TetParams& params);
+
+    // Tet mesh of the closed surface (V, F) with TetGen, or of its inside when carving. The input vertices are
+    // always the first rows of TV. With a non-empty `cache_url` the result is stored there,
+    // keyed by the content of V/F and the parameters, and reused on the next call with the same input.
+    bool Tetrahedralize(const Eigen::MatrixXd& V,
+                        const Eigen::MatrixXi& F,
+                        const TetParams&       params,
+                        Eigen::MatrixXd&       TV,
+                        Eigen::MatrixXi&       TT,
+                        const std::string&     cache_url = "");
+
+} // namespace FS
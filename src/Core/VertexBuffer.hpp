@@ -0,0 +1,167 @@
+#pragma once
+
+#include "Core/Scalar.hpp"
+
+#include <Eigen/Dense>
+
+#include <cassert>
+#include <vector>
+
+namespace FS
+{
+
+    // Memory layout of a VertexBuffer
+    //   AoS4: x0 y0 z0 _ | x1 y1 z1 _ | ...            one 16 byte (float) slot per vertex
+    //   SoA8: x0..x7 | y0..y7 | z0..z7 | x8..x15 | ...  blocks of 8 vertices, one SIMD register per axis
+    enum class VertexLayout
+    {
+        AoS4,
+        SoA8,
+    };
+
+#ifdef FS_VERTEX_LAYOUT_SOA8
+    constexpr VertexLayout kVertexLayout = VertexLayout::SoA8;
+#else
+    constexpr VertexLayout kVertexLayout = VertexLayout::AoS4;
+#endif
+
+    // Per-vertex positions stored in a cache-friendly layout. Padding slots are kept at zero.
+    template<typename S, VertexLayout L = kVertexLayout>
+    class VertexBuffer
+    {
+    public:
+        using Scalar     = S;
+        using RowVector3 = Eigen::Matrix<S, 1, 3>;
+
+        static constexpr VertexLayout kLayout      = L;
+        static constexpr int          kBlockSize   = L == VertexLayout::AoS4 ? 1 : 8;  // vertices per block
+        static constexpr int          kBlockStride = L == VertexLayout::AoS4 ? 4 : 24; // scalars per block
+
+        // Row-major Nx3 view with a stride of 4, only available for AoS4
+        using MatrixView      = Eigen::Map<Eigen::Matrix<S, Eigen::Dynamic, 3, Eigen::RowMajor>, 0, Eigen::OuterStride<4>>;
+        using ConstMatrixView = Eigen::Map<const Eigen::Matrix<S, Eigen::Dynamic, 3, Eigen::RowMajor>, 0, Eigen::OuterStride<4>>;
+
+    private:
+        std::vector<S, Eigen::aligned_allocator<S>> m_data;
+        Eigen::Index                                m_rows = 0;
+
+    public:
+        VertexBuffer() = default;
+        template<typename Derived>
+        explicit VertexBuffer(const Eigen::MatrixBase<Derived>& V)
+        {
+            *this = V;
+        }
+
+        template<typename Derived>
+        VertexBuffer& operator=(const Eigen::MatrixBase<Derived>& V)
+        {
+            assert(V.cols() == 3);
+            resize(V.rows());
+            for (Eigen::Index i = 0; i < m_rows; ++i)
+            {
+                for (int c = 0; c < 3; ++c)
+                    m_data[offset(i, c)] = static_cast<S>(V(i, c));
+            }
+            return *this;
+        }
+
+        void resize(Eigen::Index rows)
+        {
+            m_rows = rows;
+            m_data.assign(numBlocks() * kBlockStride, S(0));
+        }
+
+        Eigen::Index rows() const { return m_rows; }
+        Eigen::Index numBlocks() const { return (m_rows + kBlockSize - 1) / kBlockSize; }
+        S*           data() { return m_data.data(); }
+        const S*     data() const { return m_data.data(); }
+        S*           block(Eigen::Index b) { return m_data.data() + b * kBlockStride; }
+        const S*     block(Eigen::Index b) const { return m_data.data() + b * kBlockStride; }
+
+        static Eigen::Index offset(Eigen::Index i, int c)
+        {
+            if constexpr (L == VertexLayout::AoS4)
+                return 4 * i + c;
+            else
+                return (i >> 3) * 24 + c * 8 + (i & 7);
+        }
+
+        S&       operator()(Eigen::Index i, int c) { return m_data[offset(i, c)]; }
+        const S& operator()(Eigen::Index i, int c) const { return m_data[offset(i, c)]; }
+
+        RowVector3 row(Eigen::Index i) const { return {(*this)(i, 0), (*this)(i, 1), (*this)(i, 2)}; }
+        template<typename Derived>
+        void setRow(Eigen::Index i, const Eigen::MatrixBase<Derived>& v)
+        {
+            for (int c = 0; c < 3; ++c)
+                (*this)(i, c) = static_cast<S>(v(c));
+        }
+
+        MatrixView matrixView()
+        {
+            static_assert(L == VertexLayout::AoS4, "matrixView() needs the AoS4 layout");
+            return MatrixView(m_data.data(), m_rows, 3);
+        }
+        ConstMatrixView matrixView() const
+        {
+            static_assert(L == VertexLayout::AoS4, "matrixView() needs the AoS4 layout");
+            return ConstMatrixView(m_data.data(), m_rows, 3);
+        }
+
+        // Dense Nx3 copy, e.g. for libigl functions
+        template<typename T = S>
+        Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> toMatrix() const
+        {
+            Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> M(m_rows, 3);
+            for (Eigen::Index i = 0; i < m_rows; ++i)
+            {
+                for (int c = 0; c < 3; ++c)
+                    M(i, c) = static_cast<T>((*this)(i, c));
+            }
+            return M;
+        }
+
+        // Calls fn(i, x, y, z) for every vertex of blocks [begin_block, end_block), in order. For SoA8 the inner loop
+        // runs over 8 contiguous lanes per axis, which the compiler turns into one SIMD register per axis when fn
+        // is independent per vertex. No `omp simd` here: fn may accumulate across vertices, e.g. a sum.
+        template<typename Fn>
+        void forEachVertex(Eigen::Index begin_block, Eigen::Index end_block, Fn&& fn)
+        {
+            for (Eigen::Index b = begin_block; b < end_block; ++b)
+            {
+                S* p = block(b);
+                if constexpr (L == VertexLayout::AoS4)
+                {
+                    fn(b, p[0], p[1], p[2]);
+                }
+                else if ((b + 1) * 8 <= m_rows)
+                {
+                    for (int l = 0; l < 8; ++l)
+                        fn(b * 8 + l, p[l], p[8 + l], p[16 + l]);
+                }
+                else
+                {
+                    for (int l = 0; l < m_rows - b * 8; ++l)
+                        fn(b * 8 + l, p[l], p[8 + l], p[16 + l]);
+                }
+            }
+        }
+        template<typename Fn>
+        void forEachVertex(Fn&& fn)
+        {
+            forEachVertex(0, numBlocks(), fn);
+        }
+        template<typename Fn>
+        void parallelForEachVertex(Fn&& fn)
+        {
+            const Eigen::Index num_blocks = numBlocks();
+#pragma omp parallel for schedule(static)
+            for (Eigen::Index b = 0; b < num_blocks; ++b)
+                forEachVertex(b, b + 1, fn);
+        }
+    };
+
+    using VertexBufferS = VertexBuffer<Scalar>;
+
+} // namespace FS
@@ -0,0 +1,309 @@
+#include "Core/XPBDSolver.hpp"
+
+#include "Util/Profiler.hpp"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace FS
+{
+
+    bool XPBDSolver::Setup(const MatrixXs& X, const Eigen::MatrixXi& T, const std::vector<int>& pins)
+    {
+        PROFILE_PREC("XPBD_SETUP");
+        m_isReady   = false;
+        m_X         = X;
+        const int n = static_cast<int>(X.rows());
+        const int m = static_cast<int>(T.rows());
+
+        {
+            PROFILE_PREC("COLORING");
+            std::vector<int> offsets(n + 1, 0);
+            for (int t = 0; t < m; ++t)
+                for (int c = 0; c < 4; ++c)
+                    offsets[T(t, c) + 1]++;
+            for (int v = 0; v < n; ++v)
+                offsets[v + 1] += offsets[v];
+            std::vector<int> vertex_tets(offsets.back());
+            std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+            for (int t = 0; t < m; ++t)
+                for (int c = 0; c < 4; ++c)
+                    vertex_tets[fill[T(t, c)]++] = t;
+
+            // Greedy first-fit: the smallest color not taken by a colored tet sharing a vertex
+            std::vector<int> color(m, -1);
+            std::vector<int> taken_by; // taken_by[color] == t marks the color as taken for tet t
+            int              num_colors = 0;
+            for (int t = 0; t < m; ++t)
+            {
+                for (int c = 0; c < 4; ++c)
+                {
+                    int v = T(t, c);
+                    for (int k = offsets[v]; k < offsets[v + 1]; ++k)
+                    {
+                        int other = color[vertex_tets[k]];
+                        if (other >= 0)
+                            taken_by[other] = t;
+                    }
+                }
+                int free = 0;
+                while (free < num_colors && taken_by[free] == t)
+                    free++;
+                if (free == num_colors)
+                {
+                    num_colors++;
+                    taken_by.push_back(-1);
+                }
+                color[t] = free;
+            }
+
+            // Sort the tets by color so every color is a contiguous, parallel range
+            m_colorOffsets.assign(num_colors + 1, 0);
+            for (int t = 0; t < m; ++t)
+                m_colorOffsets[color[t] + 1]++;
+            for (int c = 0; c < num_colors; ++c)
+                m_colorOffsets[c + 1] += m_colorOffsets[c];
+            std::vector<int> next(m_colorOffsets.begin(), m_colorOffsets.end() - 1);
+            m_T.resize(m, 4);
+            m_tetIds.resize(m);
+            for (int t = 0; t < m; ++t)
+            {
+                int slot       = next[color[t]]++;
+                m_T.row(slot)  = T.row(t);
+                m_tetIds[slot] = t;
+            }
+
+            m_colorNames.resize(num_colors);
+            for (int c = 0; c < num_colors; ++c)
+                m_colorNames[c] = "COLOR_" + std::to_string(c);
+        }
+
+        {
+            PROFILE_PREC("TET_GRADIENTS");
+            m_D.resize(m);
+            m_volumes.resize(m);
+#pragma omp parallel for
+            for (int t = 0; t < m; ++t)
+            {
+                Matrix3s Dm;
+                for (int c = 0; c < 3; ++c)
+                    Dm.col(c) = (X.row(m_T(t, c + 1)) - X.row(m_T(t, 0))).transpose();
+                Scalar volume = std::abs(Dm.determinant()) / 6;
+                if (volume <= std::numeric_limits<Scalar>::epsilon())
+                {
+                    // Sliver from the mesher: infinite compliance, skipped by the solve
+                    m_D[t].setZero();
+                    m_volumes(t) = 0;
+                    continue;
+                }
+                Matrix3s DmInv       = Dm.inverse();
+                m_D[t].row(0)        = -DmInv.colwise().sum();
+                m_D[t].bottomRows(3) = DmInv;
+                m_volumes(t)         = volume;
+            }
+        }
+
+        // Lumped masses as in PDSolver, vertices without a tet keep a nominal mass
+        VectorXs mass = VectorXs::Zero(n);
+        for (int t = 0; t < m; ++t)
+            for (int c = 0; c < 4; ++c)
+                mass(m_T(t, c)) += m_params.density * m_volumes(t) / 4;
+        Scalar mean_mass = n > 0 ? mass.sum() / n : Scalar(1);
+        m_invMass.resize(n);
+        for (int v = 0; v < n; ++v)
+            m_invMass(v) = 1 / (mass(v) > 0 ? mass(v) : (mean_mass > 0 ? mean_mass : Scalar(1)));
+        m_freeInvMass = m_invMass;
+        m_pins        = pins;
+        m_dragVertex  = -1;
+        m_pinTargets.resize(pins.size(), 3);
+        for (int i = 0; i < static_cast<int>(pins.size()); ++i)
+        {
+            m_invMass(pins[i])  = 0;
+            m_pinTargets.row(i) = X.row(pins[i]);
+        }
+        m_lambdaD.resize(m);
+        m_lambdaH.resize(m);
+
+        Reset();
+        m_isReady = true;
+        spdlog::info("XPBD setup: {} vertices, {} tets, {} pins, {} colors", n, m, pins.size(), NumColors());
+        return true;
+    }
+
+    void XPBDSolver::Reset()
+    {
+        m_q = m_X;
+        m_v = MatrixXs::Zero(m_X.rows(), 3);
+    }
+
+    bool XPBDSolver::AddPin(int v, const RowVector3s& target)
+    {
+        if (!m_isReady || std::find(m_pins.begin(), m_pins.end(), v) != m_pins.end())
+            return false;
+        m_invMass(v) = 0;
+        m_v.row(v).setZero();
+        m_pins.push_back(v);
+        m_pinTargets.conservativeResize(m_pins.size(), 3);
+        m_pinTargets.bottomRows(1) = target;
+        return true;
+    }
+
+    bool XPBDSolver::RemovePin(int v)
+    {
+        auto it = std::find(m_pins.begin(), m_pins.end(), v);
+        if (!m_isReady || it == m_pins.end())
+            return false;
+        m_invMass(v)   = m_freeInvMass(v);
+        const int i    = static_cast<int>(it - m_pins.begin());
+        const int last = static_cast<int>(m_pins.size()) - 1;
+        m_pins[i]      = m_pins[last];
+        m_pins.pop_back();
+        m_pinTargets.row(i) = m_pinTargets.row(last);
+        m_pinTargets.conservativeResize(last, 3);
+        return true;
+    }
+
+    bool XPBDSolver::SetDrag(int v, const RowVector3s& target)
+    {
+        if (!m_isReady || v < 0 || v >= NumVertices())
+            return false;
+        m_dragVertex = v;
+        m_dragTarget = target;
+        return true;
+    }
+
+    void XPBDSolver::Step()
+    {
+        if (!m_isReady)
+            return;
+        PROFILE_STEP("XPBD_STEP");
+        const int    n      = NumVertices();
+        const Scalar h      = m_params.dt / m_params.substeps;
+        const Scalar inv_h2 = 1 / (h * h);
+
+        // Small steps: one or a few sweeps per substep converge better than many sweeps per step
+        for (int sub = 0; sub < m_params.substeps; ++sub)
+        {
+            MatrixXs q_prev = m_q;
+            {
+                PROFILE_STEP("PREDICT");
+#pragma omp parallel for schedule(static)
+                for (int v = 0; v < n; ++v)
+                {
+                    if (m_invMass(v) == 0)
+                        continue;
+                    m_v.row(v) += h * m_params.gravity.transpose();
+                    m_q.row(v) += h * m_v.row(v);
+                }
+                // Kinematic pins, interpolated over the substeps so a moving target does not jerk its neighbors
+                const Scalar a = Scalar(1) / (m_params.substeps - sub);
+                for (int i = 0; i < static_cast<int>(m_pins.size()); ++i)
+                    m_q.row(m_pins[i]) += a * (m_pinTargets.row(i) - m_q.row(m_pins[i]));
+                m_lambdaD.setZero();
+                m_lambdaH.setZero();
+                m_lambdaDrag.setZero();
+            }
+
+            for (int it = 0; it < m_params.iterations; ++it)
+            {
+                for (int c = 0; c < NumColors(); ++c)
+                {
+                    PROFILE_STEP(m_colorNames[c]);
+                    const int begin = m_colorOffsets[c];
+                    const int end   = m_colorOffsets[c + 1];
+#pragma omp parallel for schedule(static)
+                    for (int t = begin; t < end; ++t)
+                        SolveTet(t, inv_h2);
+                }
+                SolveDrag(inv_h2);
+                if (m_collision && m_collision->numContacts() > 0)
+                {
+                    PROFILE_STEP("CONTACTS");
+                    for (int pass = 0; pass < m_collision->m_params.iterations; ++pass)
+                        if (m_collision->solveContacts(m_q, m_invMass) == 0)
+                            break;
+                }
+            }
+
+            m_v = (m_q - q_prev) / h;
+        }
+        m_v *= m_params.damping;
+    }
+
+    void XPBDSolver::SolveTet(int t, Scalar inv_h2)
+    {
+        const Scalar volume = m_volumes(t);
+        if (volume == 0)
+            return;
+        TetGradient D = m_D[t];
+        // Active muscle: F A^-1 = X^T (D A^-1) measures the strain against the contracted rest shape
+        Matrix3s A, A_inv;
+        if (m_rig && m_rig->activeShape(m_tetIds[t], A, &A_inv))
+            D = D * A_inv;
+        Vector3s x[4];
+        Scalar   w[4];
+        for (int c = 0; c < 4; ++c)
+        {
+            x[c] = m_q.row(m_T(t, c)).transpose();
+            w[c] = m_invMass(m_T(t, c));
+        }
+        Matrix3s F = Matrix3s::Zero();
+        for (int c = 0; c < 4; ++c)
+            F += x[c] * D.row(c);
+
+        // Deviatoric: C_D = |F|_F - sqrt(3), dC/dF = F / |F|_F
+        const Scalar norm_F = F.norm();
+        if (norm_F <= std::numeric_limits<Scalar>::epsilon())
+            return;
+        const Scalar C_D = norm_F - std::sqrt(Scalar(3));
+        // Hydrostatic: C_H = det(F) - 1, dC/dF = cofactor matrix of F
+        const Scalar C_H = F.determinant() - 1;
+        Matrix3s     cof;
+        cof.col(0) = F.col(1).cross(F.col(2));
+        cof.col(1) = F.col(2).cross(F.col(0));
+        cof.col(2) = F.col(0).cross(F.col(1));
+
+        // Both constraints act on the same 4 vertices, solving them as one 2x2 system avoids the two fighting
+        // each other in the Gauss-Seidel sweep
+        Vector3s     grad_d[4], grad_h[4];
+        Scalar       a_dd = 0, a_dh = 0, a_hh = 0;
+        const Scalar alpha_d = inv_h2 / (m_params.mu * volume);
+        const Scalar alpha_h = inv_h2 / (m_params.lambda * volume);
+        for (int c = 0; c < 4; ++c)
+        {
+            grad_d[c] = F * D.row(c).transpose() / norm_F;
+            grad_h[c] = cof * D.row(c).transpose();
+            a_dd += w[c] * grad_d[c].squaredNorm();
+            a_dh += w[c] * grad_d[c].dot(grad_h[c]);
+            a_hh += w[c] * grad_h[c].squaredNorm();
+        }
+        Eigen::Matrix<Scalar, 2, 2> K;
+        K << a_dd + alpha_d, a_dh, a_dh, a_hh + alpha_h;
+        const Scalar det = K.determinant();
+        if (std::abs(det) <= std::numeric_limits<Scalar>::epsilon())
+            return;
+        Eigen::Matrix<Scalar, 2, 1> rhs(-C_D - alpha_d * m_lambdaD(t), -C_H - alpha_h * m_lambdaH(t));
+        Eigen::Matrix<Scalar, 2, 1> dlambda = K.inverse() * rhs;
+        m_lambdaD(t) += dlambda(0);
+        m_lambdaH(t) += dlambda(1);
+        for (int c = 0; c < 4; ++c)
+            x[c] += w[c] * (dlambda(0) * grad_d[c] + dlambda(1) * grad_h[c]);
+
+        for (int c = 0; c < 4; ++c)
+            m_q.row(m_T(t, c)) = x[c].transpose();
+    }
+
+    // C = q_v - target per coordinate with compliance 1 / drag_stiffness
+    void XPBDSolver::SolveDrag(Scalar inv_h2)
+    {
+        if (m_dragVertex < 0 || m_invMass(m_dragVertex) == 0)
+            return;
+        const Scalar      w       = m_invMass(m_dragVertex);
+        const Scalar      alpha   = inv_h2 / m_params.drag_stiffness;
+        const RowVector3s C       = m_q.row(m_dragVertex) - m_dragTarget;
+        const RowVector3s dlambda = (-C - alpha * m_lambdaDrag) / (w + alpha);
+        m_lambdaDrag += dlambda;
+        m_q.row(m_dragVertex) += w * dlambda;
+    }
+
+} // namespace FS
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Core/MuscleRig.hpp"
+#include "Core/Scalar.hpp"
+#include "Core/SelfCollision.hpp"
+
+#include <string>
+#include <vector>
+
+namespace FS
+{
+
+    struct XPBDParams
+    {
+        Scalar   dt             = Scalar(1) / 30;
+        int      substeps       = 4;
+        int      iterations     = 1;           // Gauss-Seidel sweeps per substep
+        Scalar   mu             = Scalar(1e3); // deviatoric (shape) stiffness per unit rest volume
+        Scalar   lambda         = Scalar(1e4); // hydrostatic (volume) stiffness per unit rest volume
+        Scalar   density        = Scalar(1);
+        Scalar   damping        = Scalar(0.98); // velocity scale per step
+        Scalar   drag_stiffness = Scalar(1e4);  // mouse drag spring stiffness
+        Vector3s gravity        = Vector3s(0, Scalar(-9.8), 0);
+    };
+
+    // Extended Position Based Dynamics (Macklin et al. 2016) with two constraints per tet after Macklin and Mueller
+    // 2021: C_D = |F|_F - sqrt(3) (deviatoric) and C_H = det(F) - 1 (hydrostatic), both zero at rest so that the
+    // multipliers can be reset every substep. Active muscle tets measure F against their contracted rest shape.
+    // Tets are greedily colored so that no two tets of a color share a vertex; the Gauss-Seidel sweep runs the
+    // colors in order and the tets of one color in parallel, without atomics. Not converged in general, meant as
+    // a cheap preview next to PDSolver. Pins have zero inverse mass and are moved to their targets kinematically.
+    struct XPBDSolver
+    {
+        using TetGradient = Eigen::Matrix<Scalar, 4, 3>; // maps the 4 corner positions to the deformation gradient
+
+        XPBDParams m_params;
+
+        MatrixXs         m_X;      // rest positions, n x 3
+        Eigen::MatrixXi  m_T;      // tets, m x 4, sorted by color
+        std::vector<int> m_tetIds; // input index of every sorted tet
+        MatrixXs         m_q;      // current positions
+        MatrixXs         m_v;      // velocities
+
+        VectorXs                 m_invMass;      // 0 for pins
+        VectorXs                 m_freeInvMass;  // without pins, restored when a pin is removed
+        std::vector<int>         m_pins;
+        MatrixXs                 m_pinTargets;   // one row per pin
+        int                      m_dragVertex = -1;
+        RowVector3s              m_dragTarget = RowVector3s::Zero();
+        RowVector3s              m_lambdaDrag = RowVector3s::Zero();
+        std::vector<TetGradient> m_D;            // per tet: F = X_local^T * D
+        VectorXs                 m_volumes;      // rest volumes, 0 for slivers
+        VectorXs                 m_lambdaD;      // accumulated multipliers, reset every substep
+        VectorXs                 m_lambdaH;
+        std::vector<int>         m_colorOffsets; // tets [offsets[c], offsets[c + 1]) have color c
+        std::vector<std::string> m_colorNames;   // profiler section per color
+        const MuscleRig*         m_rig       = nullptr; // optional active material, indexed by input tet
+        const SelfCollision*     m_collision = nullptr; // optional contacts, solved in every sweep
+
+        bool m_isReady = false;
+
+    public:
+        // Colors the tets and precomputes the rest state, recorded in g_PreComputeProfiler
+        bool Setup(const MatrixXs& X, const Eigen::MatrixXi& T, const std::vector<int>& pins);
+        // One time step of `substeps` substeps, recorded in g_StepProfiler with one section per color
+        void Step();
+        void Reset();
+
+        // Attaches tet vertex `v` to `target`, or detaches it; false if `v` already is / is not pinned
+        bool AddPin(int v, const RowVector3s& target);
+        bool RemovePin(int v);
+        // Compliant attachment of tet vertex `v` to `target`, solved after the tets in every sweep
+        bool SetDrag(int v, const RowVector3s& target);
+        void ClearDrag() { m_dragVertex = -1; }
+
+        const MatrixXs& Positions() const { return m_q; }
+        int             NumVertices() const { return static_cast<int>(m_q.rows()); }
+        int             NumTets() const { return static_cast<int>(m_T.rows()); }
+        int             NumColors() const { return static_cast<int>(m_colorOffsets.size()) - 1; }
+
+    private:
+        void SolveTet(int t, Scalar inv_h2);
+        void SolveDrag(Scalar inv_h2);
+    };
+
+} // namespace FS
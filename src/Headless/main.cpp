@@ -0,0 +1,232 @@
+// Headless batch runner: loads a mesh, runs N simulation steps and writes the deformed surface,
+// without any window, OpenGL or ImGui dependency.
+#include <iostream>
+
+#include "Core/MeshLoader.hpp"
+#include "Core/Simulator.hpp"
+#include "Core/VertexBuffer.hpp"
+#include "Util/ChromeTrace.hpp"
+#include "Util/Profiler.hpp"
+#include "Util/SnapshotWriter.hpp"
+#include "Util/StoreData.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+Util::Profiler g_FrameProfiler;
+Util::Profiler g_StepProfiler;
+Util::Profiler g_PreComputeProfiler;
+
+static void PrintUsage()
+{
+    std::cout << "USAGE: [.EXE] [MESHURL] [--steps N] [--every K] [--out DIR] [--format bin|obj] [--weld EPS]\n"
+                 "              [--max-volume VOL] [--radius-edge RATIO] [--cage MESHURL]\n"
+                 "              [--solver pd|xpbd] [--rig RIG_JSON] [--activation NAME=VALUE]...\n"
+                 "              [--jaw ANGLE] [--self-collision THICKNESS] [--trace JSON] [--perf-counters]\n"
+                 "  --steps N   number of simulation steps (default 100)\n"
+                 "  --every K   write the surface every K steps, 0 writes only the last step (default 0)\n"
+                 "  --out DIR   output directory for the frame_XXXXXX files (default ./Output)\n"
+                 "  --format F  bin: binary snapshots written in the background (default), obj: text OBJ\n"
+                 "  --weld EPS  STL vertex weld tolerance (default 0)\n"
+                 "  --max-volume VOL     tet volume bound in mesh units, 0 = unbounded (default 0)\n"
+                 "  --radius-edge RATIO  tet quality bound (default 1.414)\n"
+                 "  --cage MESHURL       coarse surface to simulate, the render surface is embedded in its tets\n"
+                 "  --solver S           pd: Projective Dynamics (default), xpbd: graph-colored XPBD\n"
+                 "  --rig RIG_JSON       muscle rig, see MuscleRig.hpp for the format\n"
+                 "  --activation N=V     activation in [0, 1] of muscle N, repeatable\n"
+                 "  --jaw ANGLE          jaw opening in radians, clamped to the rig's max_angle (default 0)\n"
+                 "  --self-collision T   enables self-collision with contact distance T, 0 = automatic\n"
+                 "  --trace JSON         records every profiler section call and writes a Chrome trace\n"
+                 "  --perf-counters      samples hardware counters (IPC, LLC and branch misses) per profiler section"
+              << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return -1;
+    }
+    std::string   mesh_url = argv[1];
+    std::string   out_dir  = "./Output";
+    int           steps    = 100;
+    int           every    = 0;
+    double        weld_eps = 0.0;
+    bool          binary   = true;
+    std::string   cage_url;
+    bool          xpbd     = false;
+    std::string   rig_url;
+    double        jaw      = 0.0;
+    double        contact  = -1.0; // < 0 disables self-collision
+    std::string   trace_url;
+    bool          counters = false; // hardware counters per section
+    FS::TetParams tet_params;
+
+    std::vector<std::pair<std::string, double>> activations;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--perf-counters")
+        {
+            counters = true;
+            continue;
+        }
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return -1;
+        }
+        if (arg == "--steps")
+            steps = std::stoi(argv[++i]);
+        else if (arg == "--every")
+            every = std::stoi(argv[++i]);
+        else if (arg == "--out")
+            out_dir = argv[++i];
+        else if (arg == "--format")
+        {
+            std::string format = argv[++i];
+            if (format != "bin" && format != "obj")
+            {
+                spdlog::error("Unknown format {}, expected bin or obj", format);
+                return -1;
+            }
+            binary = format == "bin";
+        }
+        else if (arg == "--weld")
+            weld_eps = std::stod(argv[++i]);
+        else if (arg == "--max-volume")
+            tet_params.max_volume = std::stod(argv[++i]);
+        else if (arg == "--radius-edge")
+            tet_params.radius_edge_ratio = std::stod(argv[++i]);
+        else if (arg == "--cage")
+            cage_url = argv[++i];
+        else if (arg == "--solver")
+        {
+            std::string solver = argv[++i];
+            if (solver != "pd" && solver != "xpbd")
+            {
+                spdlog::error("Unknown solver {}, expected pd or xpbd", solver);
+                return -1;
+            }
+            xpbd = solver == "xpbd";
+        }
+        else if (arg == "--rig")
+            rig_url = argv[++i];
+        else if (arg == "--jaw")
+            jaw = std::stod(argv[++i]);
+        else if (arg == "--self-collision")
+            contact = std::max(0.0, std::stod(argv[++i]));
+        else if (arg == "--trace")
+            trace_url = argv[++i];
+        else if (arg == "--activation")
+        {
+            std::string assignment = argv[++i];
+            size_t      eq         = assignment.find('=');
+            if (eq == std::string::npos)
+            {
+                PrintUsage();
+                return -1;
+            }
+            activations.emplace_back(assignment.substr(0, eq), std::stod(assignment.substr(eq + 1)));
+        }
+        else
+        {
+            PrintUsage();
+            return -1;
+        }
+    }
+
+    Eigen::MatrixXi   F;
+    FS::VertexBufferS V;
+    {
+        FS::MatrixXs V0;
+        if (!FS::LoadMesh(V0, F, mesh_url, weld_eps))
+            return 1;
+        V = V0;
+    }
+    std::filesystem::create_directories(out_dir);
+
+    FS::Simulator simulator;
+    simulator.m_tetParams   = tet_params;
+    simulator.m_solverType  = xpbd ? FS::SolverType::XPBD : FS::SolverType::PD;
+    simulator.m_tetCacheURL = Util::MeshCache::cacheURL(cage_url.empty() ? mesh_url : cage_url, "tet");
+    if (!cage_url.empty() && !FS::LoadMesh(simulator.m_cageV, simulator.m_cageF, cage_url, weld_eps))
+        return 1;
+    if (!rig_url.empty() && !simulator.m_rig.load(rig_url))
+        return 1;
+    for (const auto& [name, value] : activations)
+    {
+        int k = simulator.m_rig.findMuscle(name);
+        if (k < 0)
+        {
+            spdlog::error("Unknown muscle {}", name);
+            return 1;
+        }
+        simulator.m_rig.m_muscles[k].activation = static_cast<FS::Scalar>(value);
+    }
+    simulator.m_collision.m_params.enabled   = contact >= 0;
+    simulator.m_collision.m_params.thickness = static_cast<FS::Scalar>(std::max(0.0, contact));
+    simulator.m_rig.m_jaw.angle              = std::clamp(static_cast<FS::Scalar>(jaw), FS::Scalar(0), simulator.m_rig.m_jaw.max_angle);
+    if (!trace_url.empty())
+    {
+        g_PreComputeProfiler.startTrace();
+        g_StepProfiler.startTrace();
+    }
+    if (counters && !(g_PreComputeProfiler.enableCounters(true) && g_StepProfiler.enableCounters(true)))
+        spdlog::warn("Hardware counters unavailable, timing only: {}", Util::PerfCounters::reason());
+    simulator.Setup(V, F);
+    if (!simulator.IsReady())
+    {
+        // Otherwise every step is a no-op and the frames would be the rest pose
+        spdlog::error("Simulation setup failed for {}, no frames written", mesh_url);
+        return 1;
+    }
+
+    // Topology is constant, binary frames only carry the positions
+    if (binary)
+        Util::storeSnapshot(fmt::format("{}/topology.fssnap", out_dir), F);
+    // Binary frames are encoded into pooled buffers and written while the next steps run
+    Util::SnapshotWriter snapshot_writer;
+    auto                 write_frame = [&](int step) {
+        if (!binary)
+        {
+            Util::storeData(V.toMatrix(), F, fmt::format("{}/frame_{:06d}.obj", out_dir, step), true);
+            return;
+        }
+        std::string url = fmt::format("{}/frame_{:06d}.fssnap", out_dir, step);
+        if constexpr (FS::VertexBufferS::kLayout == FS::VertexLayout::AoS4)
+            snapshot_writer.submit(url, V.matrixView());
+        else
+            snapshot_writer.submit(url, V.toMatrix());
+    };
+    auto begin_time = std::chrono::steady_clock::now();
+    for (int step = 1; step <= steps; ++step)
+    {
+        simulator.Step(V);
+        if ((every > 0 && step % every == 0) || (every <= 0 && step == steps))
+            write_frame(step);
+    }
+    snapshot_writer.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin_time).count();
+    spdlog::info("{} steps in {:.3f} s ({:.3f} ms/step)", steps, seconds, steps > 0 ? seconds * 1e3 / steps : 0.0);
+
+    std::cout << "\n[Simulator PreCompute]\n";
+    g_PreComputeProfiler.print(std::cout);
+    std::cout << "\n[Simulator Step]\n";
+    g_StepProfiler.print(std::cout);
+
+    if (!trace_url.empty())
+    {
+        g_PreComputeProfiler.stopTrace();
+        g_StepProfiler.stopTrace();
+        if (!Util::writeChromeTrace(trace_url, {{"Simulator PreCompute", &g_PreComputeProfiler}, {"Simulator Step", &g_StepProfiler}}))
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "ImGuiContext/FrameCapture.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+
+// Private copy of the writer, so it cannot clash with the one compiled into igl::stb
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace FS
+{
+
+    void FrameCapture::init(int num_encoders)
+    {
+        if (num_encoders <= 0)
+            num_encoders = std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1, 4);
+        for (Slot& slot : m_slots)
+        {
+            glGenBuffers(1, &slot.pbo);
+        }
+        m_stop = false;
+        for (int i = 0; i < num_encoders; ++i)
+        {
+            m_encoders.emplace_back([this]() { encodeLoop(); });
+        }
+        spdlog::info(">>> FrameCapture::init - {} PBOs, {} encoder threads", kNumPBOs, num_encoders);
+    }
+
+    void FrameCapture::shutdown()
+    {
+        // Flush frames still in flight on the GPU, then let the encoders drain the queue
+        poll(true);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_jobReady.notify_all();
+        for (std::thread& t : m_encoders)
+        {
+            t.join();
+        }
+        m_encoders.clear();
+        for (Slot& slot : m_slots)
+        {
+            if (slot.fence)
+                glDeleteSync(static_cast<GLsync>(slot.fence));
+            glDeleteBuffers(1, &slot.pbo);
+            slot = Slot {};
+        }
+    }
+
+    void FrameCapture::capture(GLuint fbo, int width, int height, const std::string& url)
+    {
+        Slot& slot = m_slots[m_nextSlot];
+        if (slot.fence)
+        {
+            // Every PBO is in flight: wait for the oldest one instead of dropping a frame. Returns with the
+            // fence released, either read back or dropped with an error.
+            readback(slot, true);
+        }
+        m_nextSlot = (m_nextSlot + 1) % kNumPBOs;
+
+        size_t bytes = static_cast<size_t>(width) * height * 4;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        if (slot.capacity < bytes)
+        {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+            slot.capacity = bytes;
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // async into the PBO
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.width  = width;
+        slot.height = height;
+        slot.url    = url;
+    }
+
+    void FrameCapture::poll(bool wait)
+    {
+        // Oldest first, so frames reach the encoders in order
+        for (int i = 0; i < kNumPBOs; ++i)
+        {
+            Slot& slot = m_slots[(m_nextSlot + i) % kNumPBOs];
+            if (slot.fence)
+                readback(slot, wait);
+        }
+    }
+
+    size_t FrameCapture::pendingFrames()
+    {
+        size_t in_flight = std::count_if(std::begin(m_slots), std::end(m_slots), [](const Slot& s) { return s.fence != nullptr; });
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return in_flight + m_jobs.size() + m_busyEncoders;
+    }
+
+    void FrameCapture::readback(Slot& slot, bool wait)
+    {
+        // The flush bit makes sure the fence reaches the GPU, otherwise a blocking wait may never return
+        GLsync fence  = static_cast<GLsync>(slot.fence);
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GLuint64(1e9) : 0);
+        while (wait && status == GL_TIMEOUT_EXPIRED)
+        {
+            spdlog::warn("FrameCapture: still waiting for the GPU to finish {}", slot.url);
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
+        }
+        if (status == GL_TIMEOUT_EXPIRED)
+            return;
+        glDeleteSync(fence);
+        slot.fence = nullptr;
+        if (status == GL_WAIT_FAILED)
+        {
+            // Free the slot anyway, capture() must not overwrite a live fence
+            spdlog::error("FrameCapture: waiting for the readback failed, dropped {}", slot.url);
+            slot.url.clear();
+            return;
+        }
+
+        Job job;
+        job.width  = slot.width;
+        job.height = slot.height;
+        job.url    = std::move(slot.url);
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // Back-pressure when the encoders fall behind, so memory stays bounded
+            m_jobDone.wait(lock, [this]() { return m_jobs.size() < kMaxQueuedJobs; });
+            if (!m_pool.empty())
+            {
+                job.pixels = std::move(m_pool.back());
+                m_pool.pop_back();
+            }
+        }
+
+        size_t row_bytes = static_cast<size_t>(job.width) * 4;
+        job.pixels.resize(row_bytes * job.height);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        const auto* src = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_bytes * job.height, GL_MAP_READ_BIT));
+        if (src)
+        {
+            // OpenGL rows are bottom-up, PNG rows top-down
+            for (int y = 0; y < job.height; ++y)
+                std::memcpy(job.pixels.data() + row_bytes * y, src + row_bytes * (job.height - 1 - y), row_bytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!src)
+        {
+            spdlog::error("FrameCapture: failed to map PBO for {}", job.url);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_jobReady.notify_one();
+    }
+
+    void FrameCapture::encodeLoop()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_jobReady.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+                if (m_jobs.empty())
+                    return; // stopping and drained
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+                m_busyEncoders++;
+            }
+            m_jobDone.notify_all();
+
+            std::error_code       ec;
+            std::filesystem::path dir = std::filesystem::path(job.url).parent_path();
+            if (!dir.empty())
+                std::filesystem::create_directories(dir, ec);
+            if (!stbi_write_png(job.url.c_str(), job.width, job.height, 4, job.pixels.data(), job.width * 4))
+                spdlog::error("FrameCapture: failed to write {}", job.url);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pool.push_back(std::move(job.pixels));
+                m_busyEncoders--;
+            }
+        }
+    }
+
+} // namespace FS
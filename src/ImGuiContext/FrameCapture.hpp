@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace FS
+{
+
+    using GLuint = unsigned int;
+
+    // Asynchronous framebuffer capture. `capture` starts a glReadPixels into one of a ring of pixel buffer objects
+    // and returns immediately; `poll` maps the buffers whose transfer has finished and hands the pixels to
+    // background encoder threads that write the PNG files.
+    struct FrameCapture
+    {
+        static constexpr int kNumPBOs       = 3;
+        static constexpr int kMaxQueuedJobs = 16;
+
+        void init(int num_encoders = 0);
+        void shutdown();
+
+        // Reads the color attachment of `fbo` (width x height) into the next PBO; the frame is saved to `url`.
+        void capture(GLuint fbo, int width, int height, const std::string& url);
+        // Non-blocking unless all PBOs are in flight.
+        void poll(bool wait = false);
+
+        size_t pendingFrames();
+
+    private:
+        struct Slot
+        {
+            GLuint      pbo      = 0;
+            void*       fence    = nullptr; // GLsync
+            size_t      capacity = 0;
+            int         width    = 0;
+            int         height   = 0;
+            std::string url;
+        };
+        struct Job
+        {
+            std::vector<unsigned char> pixels;
+            int                        width  = 0;
+            int                        height = 0;
+            std::string                url;
+        };
+
+        void readback(Slot& slot, bool wait);
+        void encodeLoop();
+
+        Slot m_slots[kNumPBOs];
+        int  m_nextSlot = 0;
+
+        std::vector<std::thread>                m_encoders;
+        std::mutex                              m_mutex;
+        std::condition_variable                 m_jobReady;
+        std::condition_variable                 m_jobDone;
+        std::deque<Job>                         m_jobs;
+        std::vector<std::vector<unsigned char>> m_pool; // recycled pixel buffers
+        int                                     m_busyEncoders = 0;
+        bool                                    m_stop         = false;
+    };
+
+} // namespace FS
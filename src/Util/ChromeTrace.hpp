@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Util/Profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Util
+{
+
+    // Writes the events recorded by Profiler::startTrace as Chrome trace JSON, for chrome://tracing and
+    // https://ui.perfetto.dev. Every profiler becomes a process named by its label, every recording thread a track;
+    // sections are complete ("X") events in microseconds since the first event. Events are streamed one by one,
+    // so memory stays bounded by the rings.
+    inline bool writeChromeTrace(const std::string& url, const std::vector<std::pair<std::string, const Profiler*>>& profilers)
+    {
+        std::ofstream file(url);
+        if (!file)
+        {
+            spdlog::error("Cannot write the trace to {}", url);
+            return false;
+        }
+
+        std::vector<std::vector<Profiler::TraceEvent>> events(profilers.size());
+        double                                         origin     = std::numeric_limits<double>::max();
+        size_t                                         num_events = 0;
+        uint64_t                                       dropped    = 0;
+        for (size_t p = 0; p < profilers.size(); ++p)
+        {
+            uint64_t profiler_dropped = 0;
+            events[p]                 = profilers[p].second->traceEvents(&profiler_dropped);
+            for (const Profiler::TraceEvent& e : events[p])
+                origin = std::min(origin, e.begin);
+            num_events += events[p].size();
+            dropped += profiler_dropped;
+        }
+
+        bool first = true;
+        auto emit  = [&](const nlohmann::json& j) {
+            file << (first ? "\n" : ",\n") << j.dump();
+            first = false;
+        };
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        for (size_t p = 0; p < profilers.size(); ++p)
+        {
+            const int pid = static_cast<int>(p) + 1;
+            emit({{"name", "process_name"}, {"ph", "M"}, {"pid", pid}, {"args", {{"name", profilers[p].first}}}});
+            std::vector<uint32_t> threads;
+            for (const Profiler::TraceEvent& e : events[p])
+            {
+                if (std::find(threads.begin(), threads.end(), e.thread) == threads.end())
+                {
+                    threads.push_back(e.thread);
+                    emit({{"name", "thread_name"},
+                          {"ph", "M"},
+                          {"pid", pid},
+                          {"tid", e.thread},
+                          {"args", {{"name", "thread " + std::to_string(e.thread)}}}});
+                }
+                emit({{"name", e.section->name},
+                      {"cat", profilers[p].first},
+                      {"ph", "X"},
+                      {"pid", pid},
+                      {"tid", e.thread},
+                      {"ts", (e.begin - origin) * 1e-3},
+                      {"dur", (e.end - e.begin) * 1e-3}});
+            }
+        }
+        file << "\n]}\n";
+        if (!file)
+        {
+            spdlog::error("Writing the trace to {} failed", url);
+            return false;
+        }
+        if (dropped > 0)
+            spdlog::warn("Trace rings overflowed, the oldest {} events were dropped", dropped);
+        spdlog::info("Wrote {} trace events to {}", num_events, url);
+        return true;
+    }
+
+} // namespace Util
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define FS_HAS_MMAP 1
+#endif
+
+namespace Util
+{
+
+    // Read-only view of a whole file. Uses mmap where available and falls back to reading into memory.
+    struct MappedFile
+    {
+        const char* m_data = nullptr;
+        size_t      m_size = 0;
+
+    private:
+#ifdef FS_HAS_MMAP
+        void* m_map = nullptr;
+#endif
+        std::vector<char> m_buffer;
+
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& url) { open(url); }
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&)            = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& url)
+        {
+            close();
+#ifdef FS_HAS_MMAP
+            int fd = ::open(url.c_str(), O_RDONLY);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) != 0)
+            {
+                ::close(fd);
+                return false;
+            }
+            m_size = static_cast<size_t>(st.st_size);
+            if (m_size > 0)
+            {
+                m_map = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m_map == MAP_FAILED)
+                {
+                    m_map  = nullptr;
+                    m_size = 0;
+                    ::close(fd);
+                    return false;
+                }
+                madvise(m_map, m_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char*>(m_map);
+            }
+            ::close(fd);
+            return true;
+#else
+            std::ifstream input(url, std::ios::in | std::ios::binary | std::ios::ate);
+            if (!input)
+                return false;
+            m_buffer.resize(static_cast<size_t>(input.tellg()));
+            input.seekg(0);
+            input.read(m_buffer.data(), m_buffer.size());
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+            return true;
+#endif
+        }
+
+        void close()
+        {
+#ifdef FS_HAS_MMAP
+            if (m_map)
+                munmap(m_map, m_size);
+            m_map = nullptr;
+#endif
+            m_buffer.clear();
+            m_data = nullptr;
+            m_size = 0;
+        }
+
+        const char* data() const { return m_data; }
+        size_t      size() const { return m_size; }
+        bool        empty() const { return m_size == 0; }
+    };
+
+} // namespace Util
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "Util/MappedFile.hpp"
+
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <type_traits>
+
+namespace Util
+{
+
+    // 64-bit content hash, 8 bytes per step. Only used as a cache key, not for security.
+    inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0x9E3779B97F4A7C15ull)
+    {
+        const auto* p = static_cast<const unsigned char*>(data);
+        uint64_t    h = seed ^ (size * 0xFF51AFD7ED558CCDull);
+        auto        mix = [](uint64_t x) {
+            x ^= x >> 33;
+            x *= 0xFF51AFD7ED558CCDull;
+            x ^= x >> 33;
+            x *= 0xC4CEB9FE1A85EC53ull;
+            x ^= x >> 33;
+            return x;
+        };
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t k;
+            std::memcpy(&k, p + i, 8);
+            h = (h ^ mix(k)) * 0x9E3779B97F4A7C15ull;
+        }
+        uint64_t tail = 0;
+        if (i < size) // an empty buffer may be null
+            std::memcpy(&tail, p + i, size - i);
+        h ^= mix(tail ^ (size - i));
+        return mix(h);
+    }
+
+    inline uint64_t hashCombine(uint64_t h, uint64_t v) { return h ^ (v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2)); }
+
+    // Binary cache file:
+    //   Header  { magic, version, key, num_matrices }
+    //   Matrix  { dtype, elem_size, rows, cols } followed by the column-major payload, 16 byte aligned.
+    struct MeshCache
+    {
+        static constexpr char     kMagic[8] = {'F', 'S', 'C', 'A', 'C', 'H', 'E', '\0'};
+        static constexpr uint32_t kVersion  = 2; // 2: meshes parsed by Util::readOBJParallel instead of igl::readOBJ
+
+        struct Header
+        {
+            char     magic[8];
+            uint32_t version;
+            uint32_t num_matrices;
+            uint64_t key;
+        };
+        struct MatrixHeader
+        {
+            uint32_t dtype; // 0 = integer, 1 = floating point
+            uint32_t elem_size;
+            int64_t  rows;
+            int64_t  cols;
+        };
+
+        template<typename Scalar>
+        static constexpr uint32_t dtypeOf()
+        {
+            return std::is_floating_point_v<Scalar> ? 1u : 0u;
+        }
+        static constexpr size_t align(size_t offset) { return (offset + 15) & ~size_t(15); }
+
+        // `<dir of url>/.fscache/<file name>.<tag>.fsc`
+        static std::string cacheURL(const std::string& url, const std::string& tag)
+        {
+            namespace fs = std::filesystem;
+            fs::path src(url);
+            fs::path dir = src.parent_path() / ".fscache";
+            return (dir / (src.filename().string() + "." + tag + ".fsc")).string();
+        }
+    };
+
+    namespace detail
+    {
+        template<typename Derived>
+        bool readCacheMatrix(const MappedFile& file, size_t& offset, Eigen::PlainObjectBase<Derived>& M)
+        {
+            using Scalar = typename Derived::Scalar;
+            if (offset + sizeof(MeshCache::MatrixHeader) > file.size())
+                return false;
+            MeshCache::MatrixHeader mh;
+            std::memcpy(&mh, file.data() + offset, sizeof(mh));
+            offset += sizeof(mh);
+            if (mh.dtype != MeshCache::dtypeOf<Scalar>() || mh.elem_size != sizeof(Scalar) || mh.rows < 0 || mh.cols < 0)
+                return false;
+            if ((Derived::ColsAtCompileTime != Eigen::Dynamic && mh.cols != Derived::ColsAtCompileTime) ||
+                (Derived::RowsAtCompileTime != Eigen::Dynamic && mh.rows != Derived::RowsAtCompileTime))
+                return false;
+            offset        = MeshCache::align(offset);
+            size_t nbytes = static_cast<size_t>(mh.rows * mh.cols) * sizeof(Scalar);
+            if (offset + nbytes > file.size())
+                return false;
+            M.resize(mh.rows, mh.cols);
+            using ColMajor = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+            M = Eigen::Map<const ColMajor>(reinterpret_cast<const Scalar*>(file.data() + offset), mh.rows, mh.cols);
+            offset += nbytes;
+            return true;
+        }
+
+        template<typename Derived>
+        void writeCacheMatrix(std::ofstream& out, size_t& offset, const Eigen::MatrixBase<Derived>& M)
+        {
+            using Scalar = typename Derived::Scalar;
+            MeshCache::MatrixHeader mh {MeshCache::dtypeOf<Scalar>(), sizeof(Scalar), M.rows(), M.cols()};
+            out.write(reinterpret_cast<const char*>(&mh), sizeof(mh));
+            offset += sizeof(mh);
+            static const char zeros[16] = {};
+            out.write(zeros, MeshCache::align(offset) - offset);
+            offset = MeshCache::align(offset);
+            // Payload is always column-major so that reading maps straight into the default Eigen layout.
+            const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> cm = M;
+            size_t nbytes = static_cast<size_t>(cm.size()) * sizeof(Scalar);
+            out.write(reinterpret_cast<const char*>(cm.data()), nbytes);
+            offset += nbytes;
+        }
+    } // namespace detail
+
+    // Load matrices from a cache file, returns false on a missing, stale or incompatible cache.
+    template<typename... Derived>
+    bool loadCache(const std::string& cache_url, uint64_t key, Eigen::PlainObjectBase<Derived>&... Ms)
+    {
+        MappedFile file;
+        if (!file.open(cache_url) || file.size() < sizeof(MeshCache::Header))
+            return false;
+        MeshCache::Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, MeshCache::kMagic, sizeof(header.magic)) != 0 || header.version != MeshCache::kVersion ||
+            header.key != key || header.num_matrices != sizeof...(Derived))
+            return false;
+        size_t offset = sizeof(header);
+        return (detail::readCacheMatrix(file, offset, Ms) && ...);
+    }
+
+    template<typename... Derived>
+    bool storeCache(const std::string& cache_url, uint64_t key, const Eigen::MatrixBase<Derived>&... Ms)
+    {
+        namespace fs = std::filesystem;
+        std::error_code ec;
+        fs::create_directories(fs::path(cache_url).parent_path(), ec);
+        // Write to a temporary file first so a concurrent reader never sees a partial cache.
+        std::string   tmp_url = cache_url + ".tmp";
+        std::ofstream out(tmp_url, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            spdlog::warn("Failed to write cache {}", cache_url);
+            return false;
+        }
+        MeshCache::Header header;
+        std::memcpy(header.magic, MeshCache::kMagic, sizeof(header.magic));
+        header.version      = MeshCache::kVersion;
+        header.num_matrices = sizeof...(Derived);
+        header.key          = key;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        size_t offset = sizeof(header);
+        (detail::writeCacheMatrix(out, offset, Ms), ...);
+        out.close();
+        fs::rename(tmp_url, cache_url, ec);
+        if (ec)
+        {
+            spdlog::warn("Failed to write cache {}: {}", cache_url, ec.message());
+            return false;
+        }
+        return true;
+    }
+
+} // namespace Util
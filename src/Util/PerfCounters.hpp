@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Util
+{
+
+    // Hardware counters of the calling thread through Linux perf_event_open, user space only. The counters of a
+    // thread are opened as one group on first use, so they are scheduled together and a sample is a single read().
+    // Counters the machine does not expose (e.g. LLC misses in many VMs) stay 0; when none can be opened, e.g. in
+    // containers without CAP_PERFMON or with perf_event_paranoid > 2, sample() returns false and reason() says why.
+    // A sample costs a system call, about a microsecond, so it is only meant for sections of at least tens of us.
+    struct PerfCounters
+    {
+        enum Counter
+        {
+            CYCLES,
+            INSTRUCTIONS,
+            LLC_MISSES,
+            BRANCH_MISSES,
+            NUM_COUNTERS,
+        };
+        using Values = std::array<uint64_t, NUM_COUNTERS>;
+
+        static constexpr const char* kNames[NUM_COUNTERS] = {"cycles", "instructions", "LLC misses", "branch misses"};
+
+        // Current counts of the calling thread; false if no counter is available
+        static bool sample(Values& values) { return local().read(values); }
+        // Whether counter `c` (any counter for NUM_COUNTERS) could be opened on the calling thread
+        static bool available(Counter c = NUM_COUNTERS)
+        {
+            const PerfCounters& counters = local();
+            return c == NUM_COUNTERS ? counters.m_numOpen > 0 : counters.m_fds[c] >= 0;
+        }
+        static const std::string& reason() { return local().m_error; }
+
+        PerfCounters(const PerfCounters&)            = delete;
+        PerfCounters& operator=(const PerfCounters&) = delete;
+
+    private:
+        int         m_fds[NUM_COUNTERS] = {-1, -1, -1, -1};
+        int         m_order[NUM_COUNTERS]; // counter of every group member, in read order
+        int         m_numOpen = 0;
+        std::string m_error;
+
+        PerfCounters() { open(); }
+        ~PerfCounters()
+        {
+#ifdef __linux__
+            for (int fd : m_fds)
+            {
+                if (fd >= 0)
+                    close(fd);
+            }
+#endif
+        }
+
+        static PerfCounters& local()
+        {
+            thread_local PerfCounters t_counters;
+            return t_counters;
+        }
+
+        void open()
+        {
+#ifdef __linux__
+            const uint32_t types[NUM_COUNTERS]   = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+            const uint64_t configs[NUM_COUNTERS] = {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                PERF_COUNT_HW_BRANCH_MISSES,
+            };
+            int leader = -1;
+            for (int c = 0; c < NUM_COUNTERS; ++c)
+            {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.size           = sizeof(attr);
+                attr.type           = types[c];
+                attr.config         = configs[c];
+                attr.exclude_kernel = 1;
+                attr.exclude_hv     = 1;
+                attr.read_format    = PERF_FORMAT_GROUP;
+                // This thread on any CPU
+                const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                if (fd < 0)
+                {
+                    if (m_error.empty())
+                        m_error = std::string("perf_event_open(") + kNames[c] + "): " + std::strerror(errno);
+                    continue;
+                }
+                if (leader < 0)
+                    leader = fd;
+                m_fds[c]             = fd;
+                m_order[m_numOpen++] = c;
+            }
+            if (m_numOpen == 0 && m_error.empty())
+                m_error = "no hardware counter available";
+#else
+            m_error = "hardware counters need Linux perf_event_open";
+#endif
+        }
+
+        bool read(Values& values) const
+        {
+            values.fill(0);
+#ifdef __linux__
+            if (m_numOpen == 0)
+                return false;
+            // PERF_FORMAT_GROUP: { nr, value[nr] } in the order the members were opened
+            uint64_t buffer[1 + NUM_COUNTERS];
+            if (::read(m_fds[m_order[0]], buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(uint64_t)))
+                return false;
+            const int nr = static_cast<int>(std::min<uint64_t>(buffer[0], m_numOpen));
+            for (int i = 0; i < nr; ++i)
+                values[m_order[i]] = buffer[1 + i];
+            return true;
+#else
+            return false;
+#endif
+        }
+    };
+
+} // namespace Util
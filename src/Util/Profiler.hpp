@@ -1,37 +1,148 @@
 // ref: https://github.com/Dreamtowards/Ethertia/blob/main/src/ethertia/util/Profiler.h
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cassert>
-#include <functional>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <ostream>
 #include <string>
 #include <string_view>
 #include <thread>
 #include <vector>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "Util/PerfCounters.hpp"
+
 #define PROFILE_VN_CONCAT_INNR(a, b) a##b
 #define PROFILE_VN_CONCAT(a, b) PROFILE_VN_CONCAT_INNR(a, b)
-#define PROFILE(x) auto PROFILE_VN_CONCAT(_profiler, __COUNTER__) = g_FrameProfiler.pushCaller(x)
-#define PROFILE_PREC(x) auto PROFILE_VN_CONCAT(_profiler, __COUNTER__) = g_PreComputeProfiler.pushCaller(x)
-#define PROFILE_STEP(x) auto PROFILE_VN_CONCAT(_profiler, __COUNTER__) = g_StepProfiler.pushCaller(x)
-#define PROFILE_X(p, x) auto PROFILE_VN_CONCAT(_profiler, __COUNTER__) = p.pushCaller(x)
+#define PROFILE(x) PROFILE_X(g_FrameProfiler, x)
+#define PROFILE_PREC(x) PROFILE_X(g_PreComputeProfiler, x)
+#define PROFILE_STEP(x) PROFILE_X(g_StepProfiler, x)
+#define PROFILE_X(p, x) Util::Profiler::Scope PROFILE_VN_CONCAT(_profiler, __COUNTER__)(p, x)
 
 namespace Util
 {
 
-    struct DestructorFuncCaller
+    // 64-bit FNV-1a, constexpr so that literal section names are hashed by the compiler
+    constexpr uint64_t HashSectionName(std::string_view name)
     {
-        std::function<void()> func;
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : name)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
 
-        ~DestructorFuncCaller() { func(); }
+    // Section name and its hash, converted implicitly from literals and strings at the PROFILE call site
+    struct SectionId
+    {
+        std::string_view name;
+        uint64_t         hash;
+
+        constexpr SectionId(std::string_view _n, uint64_t _h) : name(_n), hash(_h) {}
+        constexpr SectionId(std::string_view _n) : SectionId(_n, HashSectionName(_n)) {}
+        constexpr SectionId(const char* _n) : SectionId(std::string_view(_n)) {}
+        SectionId(const std::string& _n) : SectionId(std::string_view(_n)) {}
     };
 
+    // Fixed-memory latency histogram in the spirit of HdrHistogram: a bucket per power of two of the duration in
+    // nanoseconds, split into kSubBuckets linear sub-buckets, so every percentile is within 1/16 of the true value
+    // (bucket midpoints) from 1 ns up to the full uint64 range.
+    struct LatencyHistogram
+    {
+        static constexpr int kSubBits    = 3;
+        static constexpr int kSubBuckets = 1 << kSubBits;
+        static constexpr int kNumBuckets = (64 - kSubBits + 1) * kSubBuckets;
+
+        std::array<uint32_t, kNumBuckets> counts{};
+        uint64_t                          count    = 0;
+        double                            max_time = 0.0; // exact, seconds
+
+        static int bucket(uint64_t ns)
+        {
+            if (ns < kSubBuckets)
+                return static_cast<int>(ns);
+            const int exponent = 63 - __builtin_clzll(ns); // >= kSubBits
+            const int sub      = static_cast<int>(ns >> (exponent - kSubBits)) & (kSubBuckets - 1);
+            return (exponent - kSubBits + 1) * kSubBuckets + sub;
+        }
+        // Midpoint of bucket `b` in nanoseconds
+        static double value(int b)
+        {
+            if (b < kSubBuckets)
+                return b;
+            const int    exponent = b / kSubBuckets + kSubBits - 1;
+            const double width    = std::ldexp(1.0, exponent - kSubBits);
+            return (kSubBuckets + b % kSubBuckets + 0.5) * width;
+        }
+
+        void record(double seconds)
+        {
+            counts[bucket(static_cast<uint64_t>(std::max(0.0, seconds) * 1e9))]++;
+            count++;
+            max_time = std::max(max_time, seconds);
+        }
+        // Duration in seconds below which a fraction `p` of the calls fall, 0 without samples
+        double percentile(double p) const
+        {
+            if (count == 0)
+                return 0.0;
+            const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * count)));
+            uint64_t       seen = 0;
+            for (int b = 0; b < kNumBuckets; ++b)
+            {
+                seen += counts[b];
+                if (seen >= rank)
+                    return std::min(value(b) * 1e-9, max_time);
+            }
+            return max_time;
+        }
+        void reset()
+        {
+            counts.fill(0);
+            count    = 0;
+            max_time = 0.0;
+        }
+    };
+
+    // Sections opened on the thread that recorded first go straight into the shared tree. Sections opened inside an
+    // OpenMP parallel region, or on any other thread, go into a tree private to that thread (a lane), anchored at the
+    // shared section that was open when the lane started. Lanes are registered once per thread with a lock-free
+    // push and merged into the shared tree when the root section is popped, after the parallel regions have joined,
+    // so recording never takes a lock. A merged section keeps one ThreadTime per OpenMP thread; its own time is the
+    // slowest thread per frame, which is what the enclosing section waits for.
     struct Profiler
     {
+        struct ThreadTime
+        {
+            size_t num_exec  = 0;
+            double sum_time  = 0.0;
+            double last_time = 0.0; // of the last merged frame
+
+            double frame_time = 0.0; // pending merge
+            size_t frame_exec = 0;
+        };
+
         struct Section
         {
-            std::string          name;
-            std::vector<Section> sections;
-            Section*             parent = nullptr;
+            std::string           name;
+            uint64_t              hash = 0;
+            std::list<Section>    sections; // stable addresses, lanes keep pointers to their anchor
+            std::vector<Section*> index;    // children by hash, open addressing with linear probing
+            Section*              parent = nullptr;
 
             size_t num_exec   = 0;
             double sum_time   = 0.0;
@@ -39,38 +150,171 @@ namespace Util
             double avg_time   = 0.0;
             double last_time  = 0.0;
 
-            Section& find(std::string_view _n)
+            LatencyHistogram histogram; // per call, per frame for parallel sections
+
+            // Hardware counters summed over the calls (and threads), only while Profiler::enableCounters is on
+            PerfCounters::Values counters{};
+            PerfCounters::Values begin_counters{};
+            bool                 is_counting = false;
+
+            bool reported_stray = false; // opened outside the root at least once, warned about
+
+            // Parallel sections only: per-thread time, and the time the other threads of the team spent waiting for
+            // the slowest one
+            std::vector<ThreadTime> threads;
+            double                  busy_time  = 0.0;
+            double                  idle_time  = 0.0;
+            int                     frame_team = 0; // pending merge
+
+            // O(1) expected; allocates only the first time a child is seen
+            Section& find(SectionId _id)
             {
-                assert(_n.length() > 0);
-                for (Section& s : sections)
+                assert(_id.name.length() > 0);
+                const size_t mask = index.size() - 1;
+                size_t       slot = index.empty() ? 0 : _id.hash & mask;
+                for (; !index.empty() && index[slot]; slot = (slot + 1) & mask)
                 {
-                    if (s.name == _n)
-                        return s;
+                    if (index[slot]->hash == _id.hash && index[slot]->name == _id.name)
+                        return *index[slot];
                 }
                 Section& sec = sections.emplace_back();
-                sec.name     = _n;
+                sec.name     = _id.name;
+                sec.hash     = _id.hash;
+                if (2 * sections.size() > index.size())
+                {
+                    // Keep the load factor at most 1/2
+                    index.assign(std::max<size_t>(8, 2 * index.size()), nullptr);
+                    for (Section& s : sections)
+                        insert(&s);
+                }
+                else
+                    index[slot] = &sec;
                 return sec;
             }
-            void reset()
+            void reset(bool keep_histograms = false)
             {
                 sum_time   = 0;
                 num_exec   = 0;
                 begin_time = 0;
                 avg_time   = 0;
                 last_time  = 0;
+                busy_time  = 0;
+                idle_time  = 0;
+                frame_team = 0;
+                counters.fill(0);
+                is_counting = false;
+                if (!keep_histograms)
+                    histogram.reset();
+                for (ThreadTime& t : threads)
+                    t = ThreadTime();
                 for (Section& s : sections)
                 {
-                    s.reset();
+                    s.reset(keep_histograms);
                 }
             }
+
+            bool isParallel() const { return !threads.empty(); }
+            // Calls of all threads, num_exec counts the calls of the busiest thread for parallel sections
+            size_t numCalls() const
+            {
+                size_t calls = threads.empty() ? num_exec : 0;
+                for (const ThreadTime& t : threads)
+                    calls += t.num_exec;
+                return calls;
+            }
+            bool   hasCounters() const { return counters[PerfCounters::CYCLES] > 0; }
+            double ipc() const
+            {
+                return hasCounters() ? double(counters[PerfCounters::INSTRUCTIONS]) / counters[PerfCounters::CYCLES] : 0.0;
+            }
+            double perCall(PerfCounters::Counter c) const
+            {
+                const size_t calls = numCalls();
+                return calls > 0 ? double(counters[c]) / calls : 0.0;
+            }
+            // Slowest thread over the mean of the team, 1 is perfectly balanced
+            double imbalance() const
+            {
+                if (threads.empty() || busy_time <= 0)
+                    return 1.0;
+                double slowest = 0;
+                for (const ThreadTime& t : threads)
+                    slowest = std::max(slowest, t.sum_time);
+                return slowest * threads.size() / busy_time;
+            }
+
+        private:
+            void insert(Section* s)
+            {
+                const size_t mask = index.size() - 1;
+                size_t       slot = s->hash & mask;
+                while (index[slot])
+                    slot = (slot + 1) & mask;
+                index[slot] = s;
+            }
+        };
+
+        // One timed section call, recorded only while tracing. The section's address is stable, so events carry no
+        // string; `thread` numbers the OS threads in the order they first recorded.
+        struct TraceEvent
+        {
+            const Section* section = nullptr;
+            double         begin   = 0.0; // nanoseconds()
+            double         end     = 0.0;
+            uint32_t       thread  = 0;
         };
+
+    private:
+        struct LaneTree
+        {
+            Section* anchor = nullptr; // shared section open when the lane started
+            int      thread = 0;       // OpenMP thread number
+            int      team   = 1;
+            Section  root;
+        };
+        struct ThreadLane
+        {
+            ThreadLane*         next = nullptr;
+            std::list<LaneTree> trees;
+            LaneTree*           open    = nullptr;
+            Section*            current = nullptr;
+        };
+
+        static inline std::atomic<uint64_t> s_next_id{1};
+
+        const uint64_t           m_id = s_next_id++;
+        std::atomic<ThreadLane*> m_lanes{nullptr};
+        std::vector<Section*>    m_merged; // sections touched by the current merge
+
+        // Trace ring: preallocated by startTrace, every thread claims a slot with one atomic increment
+        std::vector<TraceEvent> m_trace;
+        std::atomic<uint64_t>   m_traceCount{0};
+        std::atomic<bool>       m_isTracing{false};
+        std::atomic<bool>       m_useCounters{false};
+        bool                    m_implicitRoot = false; // the root was opened by push() around a stray section
+
+    public:
         std::thread::id m_local_thread_id;
 
-        Section  m_root_section;
-        Section* m_current_section   = &m_root_section;
-        Section* section_to_be_clear = nullptr; // clear section should after it's pop().
+        Section               m_root_section;
+        std::atomic<Section*> m_current_section{&m_root_section};
+        Section*              section_to_be_clear    = nullptr; // clear section should after it's pop().
+        bool                  clear_keeps_histograms = false;
 
     public:
+        Profiler() = default;
+        Profiler(const Profiler&)            = delete;
+        Profiler& operator=(const Profiler&) = delete;
+        ~Profiler()
+        {
+            for (ThreadLane* lane = m_lanes.load(); lane;)
+            {
+                ThreadLane* next = lane->next;
+                delete lane;
+                lane = next;
+            }
+        }
+
         static double nanoseconds()
         {
             return std::chrono::duration_cast<std::chrono::nanoseconds>(
@@ -78,79 +322,406 @@ namespace Util
                 .count();
         }
 
-        void push(std::string_view name)
+        void push(SectionId id)
         {
             if (m_root_section.sections.empty())
             {
                 m_local_thread_id = std::this_thread::get_id();
             }
-            else
+            if (isLaneThread())
             {
-                assert(m_RootSection.sections.size() == 1);
-                assert(m_LocalThreadId == std::this_thread::get_id());
+                pushLane(id);
+                return;
+            }
+            Section* current = m_current_section.load(std::memory_order_relaxed);
+            bool     stray   = false;
+            if (current == &m_root_section && !current->sections.empty())
+            {
+                Section& root = current->sections.front();
+                if (root.hash != id.hash || root.name != id.name)
+                {
+                    // A second top level section would break the single root the views expect: the existing root
+                    // is opened around it and closed with it
+                    m_implicitRoot = true;
+                    stray          = true;
+                    beginCounters(root);
+                    root.begin_time = nanoseconds();
+                    current         = &root;
+                }
+            }
+            assert(m_root_section.sections.size() <= 1);
+            Section& sec = current->find(id);
+            if (stray && !sec.reported_stray)
+            {
+                spdlog::warn("Profiler: '{}' opened outside '{}', recorded under it", sec.name, current->name);
+                sec.reported_stray = true;
             }
 
-            Section& sec = m_current_section->find(name);
-
-            sec.parent     = m_current_section; // if (sec.parent == nullptr)
+            sec.parent = current; // if (sec.parent == nullptr)
+            beginCounters(sec);
             sec.begin_time = nanoseconds();
 
-            m_current_section = &sec;
+            m_current_section.store(&sec, std::memory_order_relaxed);
         }
 
         void pop()
         {
-            if (section_to_be_clear == m_current_section)
+            if (isLaneThread())
+            {
+                popLane();
+                return;
+            }
+            Section* current = m_current_section.load(std::memory_order_relaxed);
+            if (section_to_be_clear == current)
             {
                 section_to_be_clear = nullptr;
-                auto* parent        = m_current_section->parent;
-                m_current_section->reset();
-                m_current_section = parent;
+                mergeThreads();
+                current->reset(clear_keeps_histograms);
+                m_current_section.store(current->parent, std::memory_order_relaxed);
                 return;
             }
 
-            Section& sec = *m_current_section;
+            Section& sec = *current;
 
-            double dur = (nanoseconds() - sec.begin_time) / 1e9;
+            const double now = nanoseconds();
+            double       dur = (now - sec.begin_time) / 1e9;
+            endCounters(sec);
+            if (m_isTracing.load(std::memory_order_relaxed))
+                recordTrace(sec, now);
             sec.num_exec++;
             sec.sum_time += dur;
             sec.last_time = dur;
             sec.avg_time  = sec.sum_time / sec.num_exec;
+            sec.histogram.record(dur);
 
-            m_current_section = m_current_section->parent;
+            m_current_section.store(sec.parent, std::memory_order_relaxed);
+            if (m_implicitRoot && sec.parent == &m_root_section.sections.front())
+            {
+                m_implicitRoot = false;
+                pop();
+            }
+            else if (sec.parent == &m_root_section)
+                mergeThreads();
         }
 
         Section& getRootSection()
         {
             if (m_root_section.sections.empty())
                 return m_root_section; // temporary solution when no section recorded.
-            assert(m_RootSection.sections.size() == 1);
-            return m_root_section.sections.at(0);
+            assert(m_root_section.sections.size() == 1);
+            return m_root_section.sections.front();
         }
 
         // when we want reset/clear profiler data, we cannot just direct clear,
         // it consist push/pop,. clear should be after last pop.
-        void laterClearRootSection()
+        // `keep_histograms` clears the sums but keeps the latency distributions, e.g. to show the last step next to
+        // the percentiles of all steps.
+        void laterClearRootSection(bool keep_histograms = false)
         {
-            if (m_current_section == &m_root_section)
+            if (m_current_section.load(std::memory_order_relaxed) == &m_root_section)
             { // just clear directly.
-                m_root_section.reset();
+                m_root_section.reset(keep_histograms);
             }
             else
             {
                 // Delay clear after last pop.
-                section_to_be_clear = &getRootSection();
+                section_to_be_clear    = &getRootSection();
+                clear_keeps_histograms = keep_histograms;
             }
         }
 
-        // clang-format off
-    [[nodiscard]] 
-    DestructorFuncCaller pushCaller(std::string_view name)
-    {
-        push(name);
-        return DestructorFuncCaller{ [this]() {pop();} };
-    }
-        // clang-format on
+        // Indented text dump of the section tree: total, average, count and share of the parent. Parallel sections
+        // add the thread count, the load imbalance and the share of the team's time spent idle.
+        void print(std::ostream& os)
+        {
+            if (m_root_section.sections.empty())
+                return;
+            char header[192];
+            std::snprintf(header,
+                          sizeof(header),
+                          "%-32s %15s %15s %15s %15s %8s %8s\n",
+                          "section",
+                          "total",
+                          "avg",
+                          "p99",
+                          "max",
+                          "count",
+                          "parent");
+            os << header;
+            printSection(os, getRootSection(), 0);
+        }
+        static void printSection(std::ostream& os, const Section& sec, int depth)
+        {
+            char   line[400];
+            double percent = sec.parent && sec.parent->sum_time > 0 ? 100.0 * sec.sum_time / sec.parent->sum_time : 100.0;
+            int    length  = std::snprintf(line,
+                                       sizeof(line),
+                                       "%*s%-*s %12.3f ms %12.4f ms %12.4f ms %12.4f ms %8zu %7.2f%%",
+                                       2 * depth,
+                                       "",
+                                       std::max(1, 32 - 2 * depth),
+                                       sec.name.c_str(),
+                                       sec.sum_time * 1e3,
+                                       sec.avg_time * 1e3,
+                                       sec.histogram.percentile(0.99) * 1e3,
+                                       sec.histogram.max_time * 1e3,
+                                       sec.num_exec,
+                                       percent);
+            if (sec.isParallel() && length > 0 && length < static_cast<int>(sizeof(line)))
+            {
+                const double team = sec.busy_time + sec.idle_time;
+                length += std::snprintf(line + length,
+                                        sizeof(line) - length,
+                                        "  %zu threads, imbalance %.2f, idle %.1f%%",
+                                        sec.threads.size(),
+                                        sec.imbalance(),
+                                        team > 0 ? 100.0 * sec.idle_time / team : 0.0);
+            }
+            if (sec.hasCounters() && length > 0 && length < static_cast<int>(sizeof(line)))
+            {
+                std::snprintf(line + length,
+                              sizeof(line) - length,
+                              "  IPC %.2f, LLC misses/call %.1f, branch misses/call %.1f",
+                              sec.ipc(),
+                              sec.perCall(PerfCounters::LLC_MISSES),
+                              sec.perCall(PerfCounters::BRANCH_MISSES));
+            }
+            os << line << '\n';
+            for (const Section& s : sec.sections)
+                printSection(os, s, depth + 1);
+        }
+
+        // Event recording for the Chrome trace export (Util/ChromeTrace.hpp). Start and stop between frames, not
+        // while sections are being recorded; once `capacity` events are recorded the oldest are overwritten.
+        void startTrace(size_t capacity = size_t(1) << 18)
+        {
+            m_trace.assign(std::max<size_t>(capacity, 1), TraceEvent());
+            m_traceCount.store(0, std::memory_order_relaxed);
+            m_isTracing.store(true, std::memory_order_release);
+        }
+        void stopTrace() { m_isTracing.store(false, std::memory_order_release); }
+        bool isTracing() const { return m_isTracing.load(std::memory_order_relaxed); }
+        // Events kept by the ring, oldest first; `dropped` receives the number of overwritten events
+        std::vector<TraceEvent> traceEvents(uint64_t* dropped = nullptr) const
+        {
+            const uint64_t          count = m_traceCount.load(std::memory_order_acquire);
+            const uint64_t          kept  = std::min<uint64_t>(count, m_trace.size());
+            std::vector<TraceEvent> events;
+            events.reserve(kept);
+            for (uint64_t i = count - kept; i < count; ++i)
+                events.push_back(m_trace[i % m_trace.size()]);
+            if (dropped)
+                *dropped = count - kept;
+            return events;
+        }
+
+        // Samples PerfCounters around every section from the next push on; false, and left off, when the counters
+        // cannot be opened (see PerfCounters::reason)
+        bool enableCounters(bool enable)
+        {
+            if (enable && !PerfCounters::available())
+                enable = false;
+            m_useCounters.store(enable, std::memory_order_relaxed);
+            return enable;
+        }
+        bool countersEnabled() const { return m_useCounters.load(std::memory_order_relaxed); }
+
+    private:
+        void beginCounters(Section& sec)
+        {
+            sec.is_counting = m_useCounters.load(std::memory_order_relaxed) && PerfCounters::sample(sec.begin_counters);
+        }
+        void endCounters(Section& sec)
+        {
+            PerfCounters::Values end;
+            if (!sec.is_counting || !PerfCounters::sample(end))
+                return;
+            for (int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+                sec.counters[c] += end[c] - sec.begin_counters[c];
+            sec.is_counting = false;
+        }
+
+        static uint32_t traceThread()
+        {
+            static std::atomic<uint32_t> s_next_thread{0};
+            thread_local uint32_t        t_thread = s_next_thread++;
+            return t_thread;
+        }
+        void recordTrace(const Section& sec, double now)
+        {
+            const uint64_t i            = m_traceCount.fetch_add(1, std::memory_order_relaxed);
+            m_trace[i % m_trace.size()] = {&sec, sec.begin_time, now, traceThread()};
+        }
+
+        bool isLaneThread() const
+        {
+#ifdef _OPENMP
+            if (omp_in_parallel())
+                return true;
+#endif
+            return std::this_thread::get_id() != m_local_thread_id;
+        }
+
+        static int threadNumber()
+        {
+#ifdef _OPENMP
+            return omp_get_thread_num();
+#else
+            return 0;
+#endif
+        }
+        static int teamSize()
+        {
+#ifdef _OPENMP
+            return omp_get_num_threads();
+#else
+            return 1;
+#endif
+        }
+
+        // The lane of the calling thread, registered on first use
+        ThreadLane& localLane()
+        {
+            thread_local std::vector<std::pair<uint64_t, ThreadLane*>> t_lanes;
+            for (const auto& [id, lane] : t_lanes)
+            {
+                if (id == m_id)
+                    return *lane;
+            }
+            ThreadLane* lane = new ThreadLane();
+            lane->next       = m_lanes.load(std::memory_order_relaxed);
+            while (!m_lanes.compare_exchange_weak(lane->next, lane, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+            t_lanes.emplace_back(m_id, lane);
+            return *lane;
+        }
+
+        void pushLane(SectionId id)
+        {
+            ThreadLane& lane = localLane();
+            if (!lane.open)
+            {
+                // The shared tree does not change while the parallel region runs
+                Section*  anchor = m_current_section.load(std::memory_order_acquire);
+                const int thread = threadNumber();
+                auto      it     = std::find_if(lane.trees.begin(), lane.trees.end(), [&](const LaneTree& t) {
+                    return t.anchor == anchor && t.thread == thread;
+                });
+                if (it == lane.trees.end())
+                {
+                    it         = lane.trees.emplace(lane.trees.end());
+                    it->anchor = anchor;
+                    it->thread = thread;
+                }
+                it->team     = std::max(it->team, teamSize());
+                lane.open    = &*it;
+                lane.current = &it->root;
+            }
+            Section& sec = lane.current->find(id);
+            sec.parent   = lane.current;
+            beginCounters(sec);
+            sec.begin_time = nanoseconds();
+            lane.current   = &sec;
+        }
+
+        void popLane()
+        {
+            ThreadLane& lane = localLane();
+            assert(lane.open && lane.current != &lane.open->root);
+            Section&     sec = *lane.current;
+            const double now = nanoseconds();
+            double       dur = (now - sec.begin_time) / 1e9;
+            endCounters(sec);
+            if (m_isTracing.load(std::memory_order_relaxed))
+                recordTrace(sec, now);
+            sec.num_exec++;
+            sec.sum_time += dur;
+            sec.last_time = dur;
+            lane.current  = sec.parent;
+            if (lane.current == &lane.open->root)
+            {
+                lane.open    = nullptr;
+                lane.current = nullptr;
+            }
+        }
+
+        // Folds the lanes into the shared tree, on the recording thread after every parallel region has joined
+        void mergeThreads()
+        {
+            for (ThreadLane* lane = m_lanes.load(std::memory_order_acquire); lane; lane = lane->next)
+            {
+                for (LaneTree& tree : lane->trees)
+                {
+                    for (Section& s : tree.root.sections)
+                        mergeSection(*tree.anchor, s, tree.thread, tree.team);
+                }
+            }
+            for (Section* sec : m_merged)
+            {
+                double slowest = 0, busy = 0;
+                size_t calls = 0;
+                for (ThreadTime& t : sec->threads)
+                {
+                    slowest = std::max(slowest, t.frame_time);
+                    busy += t.frame_time;
+                    calls = std::max(calls, t.frame_exec);
+                    t.sum_time += t.frame_time;
+                    t.num_exec += t.frame_exec;
+                    t.last_time  = t.frame_time;
+                    t.frame_time = 0;
+                    t.frame_exec = 0;
+                }
+                sec->num_exec += calls;
+                sec->sum_time += slowest;
+                sec->last_time = slowest;
+                sec->avg_time  = sec->num_exec > 0 ? sec->sum_time / sec->num_exec : 0.0;
+                sec->histogram.record(slowest);
+                sec->busy_time += busy;
+                sec->idle_time += std::max(0.0, sec->frame_team * slowest - busy);
+                sec->frame_team = 0;
+            }
+            m_merged.clear();
+        }
+        void mergeSection(Section& parent, Section& local, int thread, int team)
+        {
+            if (local.num_exec == 0)
+                return;
+            Section& sec = parent.find(SectionId(local.name, local.hash));
+            sec.parent   = &parent;
+            if (sec.frame_team == 0)
+                m_merged.push_back(&sec);
+            sec.frame_team = std::max(sec.frame_team, team);
+            if (static_cast<int>(sec.threads.size()) < std::max(team, thread + 1))
+                sec.threads.resize(std::max(team, thread + 1));
+            sec.threads[thread].frame_time += local.sum_time;
+            sec.threads[thread].frame_exec += local.num_exec;
+            for (int c = 0; c < PerfCounters::NUM_COUNTERS; ++c)
+                sec.counters[c] += local.counters[c];
+            local.num_exec = 0;
+            local.sum_time = 0;
+            local.counters.fill(0);
+            for (Section& s : local.sections)
+                mergeSection(sec, s, thread, team);
+        }
+
+    public:
+        // RAII section used by the PROFILE macros: one pointer, no allocation once the section exists
+        class Scope
+        {
+            Profiler& m_profiler;
+
+        public:
+            Scope(Profiler& profiler, SectionId id) : m_profiler(profiler) { m_profiler.push(id); }
+            ~Scope() { m_profiler.pop(); }
+            Scope(const Scope&)            = delete;
+            Scope& operator=(const Scope&) = delete;
+        };
     };
 
-} // namespace Util
\ No newline at end of file
+} // namespace Util
+
+// Defined by each executable (viewer and headless runner)
+extern Util::Profiler g_FrameProfiler;
+extern Util::Profiler g_StepProfiler;
+extern Util::Profiler g_PreComputeProfiler;
@@ -0,0 +1,291 @@
+#pragma once
+
+#include "Util/MappedFile.hpp"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <omp.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+
+namespace Util
+{
+
+    namespace detail
+    {
+        inline bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+        inline const char* skipBlank(const char* p, const char* end)
+        {
+            while (p < end && isBlank(*p))
+                ++p;
+            return p;
+        }
+
+        inline const char* skipToken(const char* p, const char* end)
+        {
+            while (p < end && !isBlank(*p) && *p != '\n')
+                ++p;
+            return p;
+        }
+
+        inline const char* lineEnd(const char* p, const char* end)
+        {
+            const void* nl = std::memchr(p, '\n', end - p);
+            return nl ? static_cast<const char*>(nl) : end;
+        }
+
+        enum class OBJLine
+        {
+            Other,
+            Vertex,
+            Normal,
+            Face,
+        };
+
+        // Classifies a line and returns the position right after its keyword
+        inline OBJLine classifyOBJLine(const char*& p, const char* end)
+        {
+            p = skipBlank(p, end);
+            if (end - p < 2)
+                return OBJLine::Other;
+            if (p[0] == 'v' && isBlank(p[1]))
+            {
+                p += 2;
+                return OBJLine::Vertex;
+            }
+            if (p[0] == 'f' && isBlank(p[1]))
+            {
+                p += 2;
+                return OBJLine::Face;
+            }
+            if (end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2]))
+            {
+                p += 3;
+                return OBJLine::Normal;
+            }
+            return OBJLine::Other;
+        }
+
+        template<typename Scalar>
+        inline const char* parseReal(const char* p, const char* end, Scalar& value, bool& ok)
+        {
+            p = skipBlank(p, end);
+            if (p < end && *p == '+')
+                ++p;
+            auto res = std::from_chars(p, end, value);
+            ok &= res.ec == std::errc();
+            return res.ptr;
+        }
+
+        inline int countFaceCorners(const char* p, const char* line_end)
+        {
+            int n = 0;
+            for (p = skipBlank(p, line_end); p < line_end; p = skipBlank(skipToken(p, line_end), line_end))
+                ++n;
+            return n;
+        }
+
+        struct OBJChunk
+        {
+            const char* begin = nullptr;
+            const char* end   = nullptr;
+            int64_t     num_v = 0;
+            int64_t     num_n = 0;
+            int64_t     num_t = 0; // triangles after fan triangulation
+        };
+    } // namespace detail
+
+    // Chunked parallel OBJ reader. Reads `v`, `vn` and `f` lines; polygons are fan triangulated and
+    // `f a`, `f a/b`, `f a//c`, `f a/b/c` corners with positive or negative indices are supported.
+    // The file is split at line boundaries, each thread counts then parses its chunk, and prefix sums
+    // give every chunk its output rows, so values are written straight into V, F and N.
+    template<typename DerivedV, typename DerivedF, typename DerivedN>
+    bool readOBJParallel(const std::string&                url,
+                         Eigen::PlainObjectBase<DerivedV>& V,
+                         Eigen::PlainObjectBase<DerivedF>& F,
+                         Eigen::PlainObjectBase<DerivedN>* N)
+    {
+        using namespace detail;
+        using ScalarV = typename DerivedV::Scalar;
+        using ScalarN = typename DerivedN::Scalar;
+        using Index   = typename DerivedF::Scalar;
+
+        MappedFile file;
+        if (!file.open(url))
+        {
+            spdlog::error("readOBJParallel: failed to open {}", url);
+            return false;
+        }
+        if (file.empty())
+        {
+            // An empty mapping has no data pointer to scan
+            spdlog::error("readOBJParallel: {} is empty", url);
+            return false;
+        }
+        const char* data = file.data();
+        const char* end  = data + file.size();
+
+        // Split at line boundaries
+        constexpr size_t      kMinChunkBytes = 1 << 16;
+        size_t                num_chunks     = std::max<size_t>(1, std::min<size_t>(omp_get_max_threads() * 4, file.size() / kMinChunkBytes));
+        std::vector<OBJChunk> chunks(num_chunks);
+        for (size_t c = 0; c < num_chunks; ++c)
+        {
+            const char* b = data + file.size() * c / num_chunks;
+            if (c > 0)
+                b = std::min(end, lineEnd(std::max(b, chunks[c - 1].begin), end) + 1);
+            chunks[c].begin = b;
+            if (c > 0)
+                chunks[c - 1].end = b;
+        }
+        chunks.back().end = end;
+
+        // Pass 1: count rows per chunk
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int64_t c = 0; c < static_cast<int64_t>(num_chunks); ++c)
+        {
+            OBJChunk& chunk = chunks[c];
+            for (const char* line = chunk.begin; line < chunk.end;)
+            {
+                const char* line_end = lineEnd(line, chunk.end);
+                const char* p        = line;
+                switch (classifyOBJLine(p, line_end))
+                {
+                    case OBJLine::Vertex: chunk.num_v++; break;
+                    case OBJLine::Normal: chunk.num_n++; break;
+                    case OBJLine::Face: chunk.num_t += std::max(0, countFaceCorners(p, line_end) - 2); break;
+                    default: break;
+                }
+                line = line_end + 1;
+            }
+        }
+
+        // Prefix sums give each chunk its first output row
+        std::vector<int64_t> v_offset(num_chunks + 1, 0), n_offset(num_chunks + 1, 0), t_offset(num_chunks + 1, 0);
+        for (size_t c = 0; c < num_chunks; ++c)
+        {
+            v_offset[c + 1] = v_offset[c] + chunks[c].num_v;
+            n_offset[c + 1] = n_offset[c] + chunks[c].num_n;
+            t_offset[c + 1] = t_offset[c] + chunks[c].num_t;
+        }
+        V.resize(v_offset.back(), 3);
+        F.resize(t_offset.back(), 3);
+        if (N)
+            N->resize(n_offset.back(), 3);
+
+        // Pass 2: parse
+        std::atomic<int64_t> bad_line {-1};
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int64_t c = 0; c < static_cast<int64_t>(num_chunks); ++c)
+        {
+            const OBJChunk& chunk = chunks[c];
+            int64_t         vi    = v_offset[c];
+            int64_t         ni    = n_offset[c];
+            int64_t         ti    = t_offset[c];
+            for (const char* line = chunk.begin; line < chunk.end;)
+            {
+                const char* line_end = lineEnd(line, chunk.end);
+                const char* p        = line;
+                bool        ok       = true;
+                switch (classifyOBJLine(p, line_end))
+                {
+                    case OBJLine::Vertex:
+                    {
+                        ScalarV x, y, z;
+                        p = parseReal(p, line_end, x, ok);
+                        p = parseReal(p, line_end, y, ok);
+                        p = parseReal(p, line_end, z, ok);
+                        V(vi, 0) = x;
+                        V(vi, 1) = y;
+                        V(vi, 2) = z;
+                        vi++;
+                        break;
+                    }
+                    case OBJLine::Normal:
+                    {
+                        ScalarN x, y, z;
+                        p = parseReal(p, line_end, x, ok);
+                        p = parseReal(p, line_end, y, ok);
+                        p = parseReal(p, line_end, z, ok);
+                        if (N)
+                        {
+                            (*N)(ni, 0) = x;
+                            (*N)(ni, 1) = y;
+                            (*N)(ni, 2) = z;
+                        }
+                        ni++;
+                        break;
+                    }
+                    case OBJLine::Face:
+                    {
+                        Index corner[3];
+                        int   k = 0;
+                        for (p = skipBlank(p, line_end); p < line_end; p = skipBlank(skipToken(p, line_end), line_end))
+                        {
+                            int64_t idx;
+                            auto    res = std::from_chars(p, line_end, idx);
+                            if (res.ec != std::errc() || idx == 0)
+                            {
+                                ok = false;
+                                break;
+                            }
+                            // Negative indices are relative to the vertices read so far
+                            idx = idx > 0 ? idx - 1 : vi + idx;
+                            if (idx < 0 || idx >= V.rows())
+                            {
+                                ok = false;
+                                break;
+                            }
+                            if (k < 3)
+                            {
+                                corner[k++] = static_cast<Index>(idx);
+                            }
+                            else
+                            {
+                                corner[1] = corner[2];
+                                corner[2] = static_cast<Index>(idx);
+                            }
+                            if (k == 3)
+                            {
+                                F(ti, 0) = corner[0];
+                                F(ti, 1) = corner[1];
+                                F(ti, 2) = corner[2];
+                                ti++;
+                            }
+                        }
+                        break;
+                    }
+                    default: break;
+                }
+                if (!ok)
+                {
+                    int64_t expected = -1;
+                    bad_line.compare_exchange_strong(expected, line - data);
+                    break;
+                }
+                line = line_end + 1;
+            }
+        }
+
+        if (bad_line >= 0)
+        {
+            const char* line = data + bad_line;
+            spdlog::error("readOBJParallel: failed to parse {} near \"{}\"", url, std::string(line, lineEnd(line, end)));
+            return false;
+        }
+        return true;
+    }
+
+    template<typename DerivedV, typename DerivedF>
+    bool readOBJParallel(const std::string& url, Eigen::PlainObjectBase<DerivedV>& V, Eigen::PlainObjectBase<DerivedF>& F)
+    {
+        return readOBJParallel(url, V, F, static_cast<Eigen::PlainObjectBase<DerivedV>*>(nullptr));
+    }
+
+} // namespace Util
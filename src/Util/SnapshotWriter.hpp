@@ -0,0 +1,322 @@
+#pragma once
+
+#include "Util/MappedFile.hpp"
+
+#include <Eigen/Dense>
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Util
+{
+
+    // Binary snapshot file, all fields little-endian:
+    //   Header  { magic, version, num_arrays }
+    //   Array   { dtype, elem_size, rows, cols } followed by the row-major payload, 16 byte aligned.
+    // Row-major keeps the x y z of a vertex together, e.g. numpy.frombuffer(...).reshape(rows, cols).
+    // The text writers in StoreData.hpp stay available for debugging.
+    struct Snapshot
+    {
+        static constexpr char     kMagic[8] = {'F', 'S', 'S', 'N', 'A', 'P', '\0', '\0'};
+        static constexpr uint32_t kVersion  = 1;
+
+        enum DType : uint32_t
+        {
+            DTYPE_INT32   = 0,
+            DTYPE_FLOAT32 = 1,
+            DTYPE_FLOAT64 = 2,
+        };
+
+        struct Header
+        {
+            char     magic[8];
+            uint32_t version;
+            uint32_t num_arrays;
+        };
+        struct ArrayHeader
+        {
+            uint32_t dtype;
+            uint32_t elem_size;
+            int64_t  rows;
+            int64_t  cols;
+        };
+
+        template<typename Scalar>
+        static constexpr uint32_t dtypeOf()
+        {
+            static_assert(std::is_same_v<Scalar, int> || std::is_same_v<Scalar, float> || std::is_same_v<Scalar, double>,
+                          "Snapshot arrays are int, float or double");
+            return std::is_same_v<Scalar, int> ? DTYPE_INT32 : std::is_same_v<Scalar, float> ? DTYPE_FLOAT32 : DTYPE_FLOAT64;
+        }
+        static constexpr uint32_t storedSize(uint32_t dtype) { return dtype == DTYPE_FLOAT64 ? 8 : 4; }
+        static constexpr size_t   align(size_t offset) { return (offset + 15) & ~size_t(15); }
+
+        static bool isLittleEndian()
+        {
+            const uint16_t probe = 1;
+            unsigned char  first;
+            std::memcpy(&first, &probe, 1);
+            return first == 1;
+        }
+
+        template<typename... Derived>
+        static size_t byteSize(const Eigen::MatrixBase<Derived>&... Ms)
+        {
+            size_t size = sizeof(Header);
+            ((size = align(size + sizeof(ArrayHeader)) + static_cast<size_t>(Ms.size()) * sizeof(typename Derived::Scalar)), ...);
+            return size;
+        }
+    };
+
+    namespace detail
+    {
+        template<typename T>
+        void byteSwap(T* data, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                unsigned char* b = reinterpret_cast<unsigned char*>(data + i);
+                for (size_t k = 0; k < sizeof(T) / 2; ++k)
+                    std::swap(b[k], b[sizeof(T) - 1 - k]);
+            }
+        }
+
+        template<typename Derived>
+        void writeSnapshotArray(char* buffer, size_t& offset, const Eigen::MatrixBase<Derived>& M)
+        {
+            using Scalar = typename Derived::Scalar;
+            Snapshot::ArrayHeader ah {Snapshot::dtypeOf<Scalar>(), sizeof(Scalar), M.rows(), M.cols()};
+            if (!Snapshot::isLittleEndian())
+            {
+                byteSwap(&ah.dtype, 2);
+                byteSwap(&ah.rows, 2);
+            }
+            std::memcpy(buffer + offset, &ah, sizeof(ah));
+            size_t end = offset + sizeof(ah);
+            offset     = Snapshot::align(end);
+            std::memset(buffer + end, 0, offset - end); // pooled buffers hold stale bytes
+            Scalar*   dst  = reinterpret_cast<Scalar*>(buffer + offset);
+            const int rows = static_cast<int>(M.rows());
+            const int cols = static_cast<int>(M.cols());
+            using RowMajor = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+            Eigen::Map<RowMajor>(dst, rows, cols) = M;
+            if (!Snapshot::isLittleEndian())
+                byteSwap(dst, static_cast<size_t>(M.size()));
+            offset += static_cast<size_t>(M.size()) * sizeof(Scalar);
+        }
+
+        template<typename Stored, typename Derived>
+        void readSnapshotPayload(const char* data, int64_t rows, int64_t cols, Eigen::PlainObjectBase<Derived>& M)
+        {
+            using RowMajor = Eigen::Matrix<Stored, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+            RowMajor tmp(rows, cols);
+            if (tmp.size() > 0) // an empty matrix has no data pointer
+                std::memcpy(tmp.data(), data, static_cast<size_t>(tmp.size()) * sizeof(Stored));
+            if (!Snapshot::isLittleEndian())
+                byteSwap(tmp.data(), static_cast<size_t>(tmp.size()));
+            M = tmp.template cast<typename Derived::Scalar>();
+        }
+
+        template<typename Derived>
+        bool readSnapshotArray(const MappedFile& file, size_t& offset, Eigen::PlainObjectBase<Derived>& M)
+        {
+            if (offset + sizeof(Snapshot::ArrayHeader) > file.size())
+                return false;
+            Snapshot::ArrayHeader ah;
+            std::memcpy(&ah, file.data() + offset, sizeof(ah));
+            if (!Snapshot::isLittleEndian())
+            {
+                byteSwap(&ah.dtype, 2);
+                byteSwap(&ah.rows, 2);
+            }
+            if (ah.rows < 0 || ah.cols < 0 || ah.dtype > Snapshot::DTYPE_FLOAT64 || ah.elem_size != Snapshot::storedSize(ah.dtype))
+                return false;
+            if ((Derived::ColsAtCompileTime != Eigen::Dynamic && ah.cols != Derived::ColsAtCompileTime) ||
+                (Derived::RowsAtCompileTime != Eigen::Dynamic && ah.rows != Derived::RowsAtCompileTime))
+                return false;
+            // A corrupt shape must neither overflow the byte count nor index past the mapping
+            const size_t rows = static_cast<size_t>(ah.rows);
+            const size_t cols = static_cast<size_t>(ah.cols);
+            if (cols != 0 && rows > std::numeric_limits<size_t>::max() / ah.elem_size / cols)
+                return false;
+            const size_t nbytes = rows * cols * ah.elem_size;
+            offset              = Snapshot::align(offset + sizeof(ah));
+            if (offset > file.size() || nbytes > file.size() - offset)
+                return false;
+            // Stored types are converted to the destination scalar, e.g. a float snapshot into a double matrix
+            const char* payload = file.data() + offset;
+            switch (ah.dtype)
+            {
+                case Snapshot::DTYPE_INT32: readSnapshotPayload<int32_t>(payload, ah.rows, ah.cols, M); break;
+                case Snapshot::DTYPE_FLOAT32: readSnapshotPayload<float>(payload, ah.rows, ah.cols, M); break;
+                case Snapshot::DTYPE_FLOAT64: readSnapshotPayload<double>(payload, ah.rows, ah.cols, M); break;
+            }
+            offset += nbytes;
+            return true;
+        }
+    } // namespace detail
+
+    // Serializes the matrices into `buffer`, reusing its capacity
+    template<typename... Derived>
+    void encodeSnapshot(std::vector<char>& buffer, const Eigen::MatrixBase<Derived>&... Ms)
+    {
+        buffer.resize(Snapshot::byteSize(Ms...));
+        Snapshot::Header header;
+        std::memcpy(header.magic, Snapshot::kMagic, sizeof(header.magic));
+        header.version    = Snapshot::kVersion;
+        header.num_arrays = sizeof...(Derived);
+        if (!Snapshot::isLittleEndian())
+            detail::byteSwap(&header.version, 2);
+        std::memcpy(buffer.data(), &header, sizeof(header));
+        size_t offset = sizeof(header);
+        (detail::writeSnapshotArray(buffer.data(), offset, Ms), ...);
+    }
+
+    inline bool writeFileBytes(const std::string& url, const std::vector<char>& bytes)
+    {
+        FILE* f = std::fopen(url.c_str(), "wb");
+        if (!f)
+            return false;
+        bool ok = std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+        return std::fclose(f) == 0 && ok;
+    }
+
+    // Synchronous snapshot store/load
+    template<typename... Derived>
+    bool storeSnapshot(const std::string& url, const Eigen::MatrixBase<Derived>&... Ms)
+    {
+        std::vector<char> buffer;
+        encodeSnapshot(buffer, Ms...);
+        if (!writeFileBytes(url, buffer))
+        {
+            spdlog::error("Failed to write snapshot {}", url);
+            return false;
+        }
+        return true;
+    }
+
+    template<typename... Derived>
+    bool loadSnapshot(const std::string& url, Eigen::PlainObjectBase<Derived>&... Ms)
+    {
+        MappedFile file;
+        if (!file.open(url) || file.size() < sizeof(Snapshot::Header))
+            return false;
+        Snapshot::Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (!Snapshot::isLittleEndian())
+            detail::byteSwap(&header.version, 2);
+        if (std::memcmp(header.magic, Snapshot::kMagic, sizeof(header.magic)) != 0 || header.version != Snapshot::kVersion ||
+            header.num_arrays != sizeof...(Derived))
+            return false;
+        size_t offset = sizeof(header);
+        return (detail::readSnapshotArray(file, offset, Ms) && ...);
+    }
+
+    // Writes snapshots on a background thread. `submit` only encodes into a pooled buffer and returns;
+    // it blocks only when `max_queued` snapshots are still waiting for the disk.
+    class SnapshotWriter
+    {
+    public:
+        explicit SnapshotWriter(size_t max_queued = 8)
+            : m_maxQueued(max_queued)
+        {
+            m_thread = std::thread([this]() { run(); });
+        }
+        ~SnapshotWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_workCv.notify_all();
+            m_thread.join();
+        }
+        SnapshotWriter(const SnapshotWriter&)            = delete;
+        SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+        template<typename... Derived>
+        void submit(std::string url, const Eigen::MatrixBase<Derived>&... Ms)
+        {
+            std::vector<char> buffer;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_doneCv.wait(lock, [this]() { return m_queue.size() < m_maxQueued; });
+                if (!m_pool.empty())
+                {
+                    buffer = std::move(m_pool.back());
+                    m_pool.pop_back();
+                }
+            }
+            encodeSnapshot(buffer, Ms...);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back({std::move(url), std::move(buffer)});
+            }
+            m_workCv.notify_one();
+        }
+
+        // Blocks until every submitted snapshot is on disk
+        void flush()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_doneCv.wait(lock, [this]() { return m_queue.empty() && !m_isWriting; });
+        }
+
+        size_t pendingSnapshots()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_queue.size() + (m_isWriting ? 1 : 0);
+        }
+
+    private:
+        struct Job
+        {
+            std::string       url;
+            std::vector<char> bytes;
+        };
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (true)
+            {
+                m_workCv.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return; // stop requested and drained
+                Job job = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_isWriting = true;
+                lock.unlock();
+
+                if (!writeFileBytes(job.url, job.bytes))
+                    spdlog::error("Failed to write snapshot {}", job.url);
+
+                lock.lock();
+                m_isWriting = false;
+                m_pool.push_back(std::move(job.bytes));
+                m_doneCv.notify_all();
+            }
+        }
+
+        size_t                         m_maxQueued;
+        std::mutex                     m_mutex;
+        std::condition_variable        m_workCv;
+        std::condition_variable        m_doneCv;
+        std::deque<Job>                m_queue;
+        std::vector<std::vector<char>> m_pool;
+        bool                           m_isWriting = false;
+        bool                           m_stop      = false;
+        std::thread                    m_thread;
+    };
+
+} // namespace Util
@@ -30,7 +30,8 @@ namespace Util
         f.close();
     };
 
-    inline void storeData(const Eigen::MatrixXd& M, std::string url, bool active = false, bool storeFull = false)
+    template<typename Derived>
+    void storeData(const Eigen::MatrixBase<Derived>& M, std::string url, bool active = false, bool storeFull = false)
     {
         if (!active)
             return;
@@ -52,11 +53,12 @@ namespace Util
         f.close();
     };
 
-    inline void storeData(const Eigen::MatrixXd& pos,
-                          const Eigen::MatrixXi& tris,
-                          std::string            url,
-                          bool                   active = false,
-                          bool /*storeFull*/            = false)
+    template<typename DerivedV, typename DerivedF>
+    void storeData(const Eigen::MatrixBase<DerivedV>& pos,
+                   const Eigen::MatrixBase<DerivedF>& tris,
+                   std::string                        url,
+                   bool                               active = false,
+                   bool /*storeFull*/                        = false)
     {
         if (!active)
             return;
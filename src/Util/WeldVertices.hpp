@@ -0,0 +1,173 @@
+#pragma once
+
+#include <Eigen/Dense>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Util
+{
+
+    struct WeldStats
+    {
+        int64_t input_vertices   = 0;
+        int64_t output_vertices  = 0;
+        int64_t welded_vertices  = 0; // input vertices merged into another one
+        int64_t degenerate_faces = 0; // faces with a repeated corner after welding
+    };
+
+    namespace detail
+    {
+        inline uint64_t hashCell(int64_t x, int64_t y, int64_t z)
+        {
+            uint64_t h = static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull;
+            h ^= static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+            h ^= static_cast<uint64_t>(z) * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+            return h ^ (h >> 29);
+        }
+
+        template<typename Scalar>
+        inline int64_t exactCell(Scalar v)
+        {
+            double d = static_cast<double>(v) + 0.0; // folds -0 into +0
+            int64_t bits;
+            std::memcpy(&bits, &d, sizeof(bits));
+            return bits;
+        }
+    } // namespace detail
+
+    // Merges vertices closer than `eps` (exact duplicates when `eps` is 0) and remaps F in place.
+    // Vertices are bucketed by a hash of their grid cell of size `eps`, each vertex looks up the 27
+    // neighbouring cells and points to the lowest close index, then chains are collapsed to their root.
+    // Every step is linear in #V + #F and runs in parallel; the output keeps the input vertex order.
+    template<typename DerivedV, typename DerivedF>
+    WeldStats weldVertices(Eigen::PlainObjectBase<DerivedV>& V, Eigen::PlainObjectBase<DerivedF>& F, double eps)
+    {
+        using Scalar = typename DerivedV::Scalar;
+        using Index  = typename DerivedF::Scalar;
+
+        const int64_t n = V.rows();
+        WeldStats     stats;
+        stats.input_vertices = n;
+        if (n == 0)
+            return stats;
+
+        const bool   exact   = !(eps > 0.0);
+        const double inv_eps = exact ? 0.0 : 1.0 / eps;
+        const double eps2    = eps * eps;
+        auto         cellOf  = [&](int64_t i, int axis) -> int64_t {
+            return exact ? detail::exactCell(V(i, axis)) : static_cast<int64_t>(std::floor(V(i, axis) * inv_eps));
+        };
+
+        // Bucket vertices by cell hash (CSR layout)
+        uint64_t num_buckets = 1;
+        while (num_buckets < 2 * static_cast<uint64_t>(n))
+            num_buckets <<= 1;
+        const uint64_t        mask = num_buckets - 1;
+        std::vector<int64_t>  cell(3 * n);
+        std::vector<uint32_t> bucket_of(n);
+        std::vector<int64_t>  bucket_begin(num_buckets + 1, 0);
+#pragma omp parallel for
+        for (int64_t i = 0; i < n; ++i)
+        {
+            for (int a = 0; a < 3; ++a)
+                cell[3 * i + a] = cellOf(i, a);
+            bucket_of[i] = static_cast<uint32_t>(detail::hashCell(cell[3 * i], cell[3 * i + 1], cell[3 * i + 2]) & mask);
+#pragma omp atomic
+            bucket_begin[bucket_of[i] + 1]++;
+        }
+        for (uint64_t b = 0; b < num_buckets; ++b)
+            bucket_begin[b + 1] += bucket_begin[b];
+        std::vector<int64_t> bucket_fill(bucket_begin.begin(), bucket_begin.end() - 1);
+        std::vector<int64_t> bucket_items(n);
+#pragma omp parallel for
+        for (int64_t i = 0; i < n; ++i)
+        {
+            int64_t slot;
+#pragma omp atomic capture
+            slot = bucket_fill[bucket_of[i]]++;
+            bucket_items[slot] = i;
+        }
+
+        // Each vertex points to the lowest-index vertex within eps
+        std::vector<int64_t> rep(n);
+        const int            reach = exact ? 0 : 1;
+#pragma omp parallel for schedule(dynamic, 1024)
+        for (int64_t i = 0; i < n; ++i)
+        {
+            int64_t best = i;
+            for (int dx = -reach; dx <= reach; ++dx)
+                for (int dy = -reach; dy <= reach; ++dy)
+                    for (int dz = -reach; dz <= reach; ++dz)
+                    {
+                        uint64_t b = detail::hashCell(cell[3 * i] + dx, cell[3 * i + 1] + dy, cell[3 * i + 2] + dz) & mask;
+                        for (int64_t k = bucket_begin[b]; k < bucket_begin[b + 1]; ++k)
+                        {
+                            int64_t j = bucket_items[k];
+                            if (j >= best)
+                                continue;
+                            bool close;
+                            if (exact)
+                                close = cell[3 * j] == cell[3 * i] && cell[3 * j + 1] == cell[3 * i + 1] &&
+                                        cell[3 * j + 2] == cell[3 * i + 2];
+                            else
+                                close = (V.row(j) - V.row(i)).template cast<double>().squaredNorm() <= eps2;
+                            if (close)
+                                best = j;
+                        }
+                    }
+            rep[i] = best;
+        }
+
+        // Collapse chains (rep[i] <= i, so following them terminates) and number the roots
+        std::vector<int64_t> root(n);
+#pragma omp parallel for
+        for (int64_t i = 0; i < n; ++i)
+        {
+            int64_t r = i;
+            while (rep[r] != r)
+                r = rep[r];
+            root[i] = r;
+        }
+        std::vector<int64_t> new_index(n, -1);
+        int64_t              num_out = 0;
+        for (int64_t i = 0; i < n; ++i)
+        {
+            if (root[i] == i)
+                new_index[i] = num_out++;
+        }
+
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> welded(num_out, V.cols());
+#pragma omp parallel for
+        for (int64_t i = 0; i < n; ++i)
+        {
+            if (new_index[i] >= 0)
+                welded.row(new_index[i]) = V.row(i);
+        }
+        V = welded;
+
+        int64_t degenerate = 0;
+#pragma omp parallel for reduction(+ : degenerate)
+        for (int64_t f = 0; f < F.rows(); ++f)
+        {
+            for (int c = 0; c < F.cols(); ++c)
+                F(f, c) = static_cast<Index>(new_index[root[F(f, c)]]);
+            for (int c = 0; c < F.cols(); ++c)
+            {
+                if (F(f, c) == F(f, (c + 1) % F.cols()))
+                {
+                    degenerate++;
+                    break;
+                }
+            }
+        }
+
+        stats.output_vertices  = num_out;
+        stats.welded_vertices  = n - num_out;
+        stats.degenerate_faces = degenerate;
+        return stats;
+    }
+
+} // namespace Util
@@ -6,8 +6,11 @@
 #include <igl/winding_number.h>
 #include <igl/opengl/glfw/Viewer.h>
 #include <Eigen/Sparse>
+#include <chrono>
 #include <iostream>
 
+#include "Core/FastWindingNumber.hpp"
+
 
 Eigen::MatrixXd V,BC;
 Eigen::VectorXd W;
@@ -115,7 +118,22 @@ int main(int argc, char *argv[])
 
   // Compute generalized winding number at all barycenters
   cout<<"Computing winding number over all "<<T.rows()<<" tets..."<<endl;
+  auto begin = chrono::steady_clock::now();
   igl::winding_number(V,F,BC,W);
+  double exact_ms = chrono::duration<double,milli>(chrono::steady_clock::now()-begin).count();
+
+  // Same query through the tree approximation
+  begin = chrono::steady_clock::now();
+  FS::FastWindingNumber fwn;
+  fwn.build(V.cast<FS::Scalar>(),F);
+  FS::VectorXs W_fast;
+  fwn.query(BC.cast<FS::Scalar>(),W_fast);
+  double fast_ms = chrono::duration<double,milli>(chrono::steady_clock::now()-begin).count();
+  const VectorXd W_diff = W - W_fast.cast<double>();
+  const int mismatch = ((W.array()>0.5) != (W_fast.array()>0.5)).count();
+  cout<<"igl::winding_number:   "<<exact_ms<<" ms"<<endl;
+  cout<<"FS::FastWindingNumber: "<<fast_ms<<" ms (beta = "<<fwn.m_beta<<")"<<endl;
+  cout<<"max |error| = "<<W_diff.cwiseAbs().maxCoeff()<<", inside/outside mismatches = "<<mismatch<<endl;
 
   // Extract interior tets
   MatrixXi CT((W.array()>0.5).count(),4);
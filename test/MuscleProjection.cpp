@@ -0,0 +1,116 @@
+// Checks the active muscle projection of the PD local step: for a single tet with a random deformation, fiber and
+// activation, the target the solver projects onto must be R A with a rotation R and at least as close to F as R' A
+// for any rotation R': the exact minimizer polar(F A^T) A from Eigen's SVD, and small perturbations of R.
+// Exits with 1 on a violation.
+// USAGE: MuscleProjection [NUM_CASES] [NUM_PERTURBATIONS]
+#include "Core/PDSolver.hpp"
+#include "Util/Profiler.hpp"
+
+#include <Eigen/Geometry>
+#include <Eigen/SVD>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace FS;
+
+Util::Profiler g_FrameProfiler;
+Util::Profiler g_StepProfiler;
+Util::Profiler g_PreComputeProfiler;
+
+static Matrix3s ClosestRotation(const Matrix3s& M)
+{
+    Eigen::JacobiSVD<Matrix3s> svd(M, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Matrix3s                   U = svd.matrixU();
+    if ((U * svd.matrixV().transpose()).determinant() < 0)
+        U.col(2) *= -1;
+    return U * svd.matrixV().transpose();
+}
+
+// Rotation by a small random angle about a random axis
+static Matrix3s SmallRotation(std::mt19937& rng, Scalar max_angle)
+{
+    std::normal_distribution<Scalar>       normal;
+    std::uniform_real_distribution<Scalar> angle(-max_angle, max_angle);
+    const Vector3s                         axis = Vector3s(normal(rng), normal(rng), normal(rng)).normalized();
+    return Eigen::AngleAxis<Scalar>(angle(rng), axis).toRotationMatrix();
+}
+
+int main(int argc, char* argv[])
+{
+    const int num_cases     = argc > 1 ? std::stoi(argv[1]) : 1000;
+    const int num_perturbed = argc > 2 ? std::stoi(argv[2]) : 50;
+
+    std::mt19937                           rng(7);
+    std::uniform_real_distribution<Scalar> uniform(-1, 1);
+    std::uniform_real_distribution<Scalar> activation(Scalar(0.05), 1);
+
+    MatrixXs X(4, 3);
+    X << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+    Eigen::MatrixXi T(1, 4);
+    T << 0, 1, 2, 3;
+
+    int    num_failures = 0;
+    Scalar worst_gap    = 0; // smallest |F - R' A| - |F - target| seen, negative values are violations
+    Scalar worst_shape  = 0; // largest |(target A^-1)^T (target A^-1) - I|
+    for (int c = 0; c < num_cases; ++c)
+    {
+        MuscleRig rig;
+        rig.m_muscles.resize(1);
+        rig.m_muscles[0].activation = activation(rng);
+        rig.m_tetMuscle             = {0};
+        rig.m_tetFiber              = {Vector3s(uniform(rng), uniform(rng), uniform(rng)).normalized()};
+
+        PDSolver solver;
+        solver.m_params.gravity.setZero();
+        solver.m_params.iterations = 1;
+        {
+            PROFILE_PREC("PRECOMPUTE");
+            solver.Setup(X, T, {});
+        }
+        solver.m_rig = &rig;
+
+        // Rest-space deformation F, so the local step of the first iteration sees exactly this F
+        Matrix3s F;
+        for (int k = 0; k < 9; ++k)
+            F(k / 3, k % 3) = (k % 4 == 0 ? 1 : 0) + Scalar(0.5) * uniform(rng);
+        solver.m_q = X * F.transpose();
+        solver.m_v.setZero();
+        {
+            PROFILE_STEP("STEP");
+            solver.Step();
+        }
+
+        // m_projections = w D target^T
+        const PDSolver::TetGradient& D      = solver.m_D[0];
+        const Matrix3s               target = ((D.transpose() * D).inverse() * D.transpose() * solver.m_projections[0] /
+                                 solver.m_weights(0))
+                                    .transpose();
+        Matrix3s A, A_inv;
+        rig.activeShape(0, A, &A_inv);
+        const Matrix3s R = target * A_inv;
+        worst_shape      = std::max(worst_shape, (R.transpose() * R - Matrix3s::Identity()).norm());
+
+        const Scalar distance = (F - target).norm();
+        Scalar       gap      = (F - ClosestRotation(F * A.transpose()) * A).norm() - distance;
+        for (int r = 0; r < num_perturbed; ++r)
+            gap = std::min(gap, (F - R * SmallRotation(rng, Scalar(0.05)) * A).norm() - distance);
+        worst_gap = c == 0 ? gap : std::min(worst_gap, gap);
+        if (gap < -Scalar(1e-4) * F.norm() || R.determinant() < 0)
+            num_failures++;
+    }
+    std::printf("%d cases, %d perturbations each: min |F - R'A| - |F - target| = %g, max |R^T R - I| = %g\n",
+                num_cases,
+                num_perturbed,
+                double(worst_gap),
+                double(worst_shape));
+    if (num_failures > 0 || worst_shape > Scalar(1e-3))
+    {
+        std::printf("FAILED: %d cases with a closer R'A\n", num_failures);
+        return 1;
+    }
+    std::printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Per-scope overhead of Util::Profiler: literal and runtime names, many siblings, OpenMP lanes, and the previous
+// std::function scope with a linear name scan for comparison. Counts heap allocations inside the timed loops.
+// USAGE: ProfilerBench [NUM_SCOPES] [REPEAT]
+#include "Util/Profiler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+Util::Profiler g_FrameProfiler;
+Util::Profiler g_StepProfiler;
+Util::Profiler g_PreComputeProfiler;
+
+static std::atomic<size_t> s_allocations{0};
+
+void* operator new(size_t size)
+{
+    s_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static double BestOf(int repeat, const std::function<void()>& kernel)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        kernel();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+    }
+    return best;
+}
+
+// Runs `kernel` once to create the sections, then times it and counts the allocations of the timed runs
+static void Run(const char* name, int n, int repeat, const std::function<void()>& kernel)
+{
+    kernel();
+    const size_t allocations = s_allocations.load();
+    const double s           = BestOf(repeat, kernel);
+    const double per_run     = double(s_allocations.load() - allocations) / repeat;
+    std::printf("%-28s %8.1f ns/scope  %8.2f allocations/run\n", name, s / n * 1e9, per_run);
+}
+
+// The scope the PROFILE macros used before: a std::function capturing the profiler and a linear scan by name
+struct LegacyProfiler
+{
+    struct Section
+    {
+        std::string          name;
+        std::vector<Section> sections;
+        Section*             parent     = nullptr;
+        double               begin_time = 0, sum_time = 0;
+        size_t               num_exec   = 0;
+
+        Section& find(std::string_view _n)
+        {
+            for (Section& s : sections)
+                if (s.name == _n)
+                    return s;
+            Section& sec = sections.emplace_back();
+            sec.name     = _n;
+            return sec;
+        }
+    };
+    struct Caller
+    {
+        std::function<void()> func;
+        ~Caller() { func(); }
+    };
+
+    Section  m_root;
+    Section* m_current = &m_root;
+
+    void push(std::string_view name)
+    {
+        Section& sec   = m_current->find(name);
+        sec.parent     = m_current;
+        sec.begin_time = Util::Profiler::nanoseconds();
+        m_current      = &sec;
+    }
+    void pop()
+    {
+        m_current->sum_time += Util::Profiler::nanoseconds() - m_current->begin_time;
+        m_current->num_exec++;
+        m_current = m_current->parent;
+    }
+    [[nodiscard]] Caller pushCaller(std::string_view name)
+    {
+        push(name);
+        return Caller{[this]() { pop(); }};
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    const int n      = argc > 1 ? std::stoi(argv[1]) : 1 << 20;
+    const int repeat = argc > 2 ? std::stoi(argv[2]) : 5;
+    std::printf("%d scopes per run, best of %d\n", n, repeat);
+
+    Run("clock only", n, repeat, [&]() {
+        double sum = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            double begin = Util::Profiler::nanoseconds();
+            sum += Util::Profiler::nanoseconds() - begin;
+        }
+        if (sum < 0)
+            std::printf("\n");
+    });
+
+    Util::Profiler profiler;
+    Run("literal name", n, repeat, [&]() {
+        PROFILE_X(profiler, "ROOT");
+        for (int i = 0; i < n; ++i)
+        {
+            PROFILE_X(profiler, "LOOP");
+        }
+    });
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 64; ++i)
+        names.push_back("SIBLING_" + std::to_string(i));
+    Run("runtime name, 64 siblings", n, repeat, [&]() {
+        PROFILE_X(profiler, "ROOT");
+        for (int i = 0; i < n; ++i)
+        {
+            PROFILE_X(profiler, names[i & 63]);
+        }
+    });
+
+    Run("omp lanes", n, repeat, [&]() {
+        PROFILE_X(profiler, "ROOT");
+#pragma omp parallel
+        {
+#pragma omp for schedule(static)
+            for (int i = 0; i < n; ++i)
+            {
+                PROFILE_X(profiler, "LANE");
+            }
+        }
+    });
+
+    LegacyProfiler legacy;
+    Run("legacy, 64 siblings", n, repeat, [&]() {
+        auto root = legacy.pushCaller("ROOT");
+        for (int i = 0; i < n; ++i)
+        {
+            auto scope = legacy.pushCaller(names[i & 63]);
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Throughput and accuracy of the batched 3x3 polar decomposition vs. Eigen's per-element JacobiSVD.
+// USAGE: SVDBench [NUM_MATRICES] [REPEAT]
+#include "Core/SVD3.hpp"
+
+#include <Eigen/SVD>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace FS;
+
+static double BestOf(int repeat, const std::function<void()>& kernel)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        kernel();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+    }
+    return best;
+}
+
+static Matrix3s EigenPolar(const Matrix3s& F)
+{
+    Eigen::JacobiSVD<Matrix3s> svd(F, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Matrix3s                   U = svd.matrixU();
+    if ((U * svd.matrixV().transpose()).determinant() < 0)
+        U.col(2) *= -1;
+    return U * svd.matrixV().transpose();
+}
+
+// Runs SVD3<Scalar, W> single threaded on SoA blocks of W matrices
+template<int W>
+static double RunLanes(const std::vector<Matrix3s>& F, std::vector<Matrix3s>& R, int repeat)
+{
+    using P              = Pack<Scalar, W>;
+    const int n          = static_cast<int>(F.size());
+    const int num_blocks = n / W;
+    std::vector<P> A(9 * num_blocks), Rb(9 * num_blocks);
+    for (int b = 0; b < num_blocks; ++b)
+        for (int l = 0; l < W; ++l)
+            for (int k = 0; k < 9; ++k)
+                A[9 * b + k].v[l] = F[b * W + l](k / 3, k % 3);
+
+    double s = BestOf(repeat, [&]() {
+        for (int b = 0; b < num_blocks; ++b)
+            SVD3<Scalar, W>::polar(reinterpret_cast<const P(&)[9]>(A[9 * b]), reinterpret_cast<P(&)[9]>(Rb[9 * b]));
+    });
+
+    R.resize(n);
+    for (int b = 0; b < num_blocks; ++b)
+        for (int l = 0; l < W; ++l)
+            for (int k = 0; k < 9; ++k)
+                R[b * W + l](k / 3, k % 3) = Rb[9 * b + k].v[l];
+    return s;
+}
+
+static void Report(const std::string& name, int n, double seconds, const std::vector<Matrix3s>& F, const std::vector<Matrix3s>& R,
+                   const std::vector<Matrix3s>& reference)
+{
+    Scalar max_diff = 0, max_ortho = 0, min_det = 1;
+    for (int i = 0; i < n; ++i)
+    {
+        max_diff  = std::max(max_diff, (R[i] - reference[i]).cwiseAbs().maxCoeff());
+        max_ortho = std::max(max_ortho, (R[i].transpose() * R[i] - Matrix3s::Identity()).cwiseAbs().maxCoeff());
+        min_det   = std::min(min_det, R[i].determinant());
+    }
+    std::printf("%-18s %10.1f Mmat/s  (%8.3f ms)  max|R-R_eigen| %.2e  max|RtR-I| %.2e  min det %.4f\n",
+                name.c_str(), n / seconds * 1e-6, seconds * 1e3, double(max_diff), double(max_ortho), double(min_det));
+}
+
+int main(int argc, char* argv[])
+{
+    const int n      = argc > 1 ? std::stoi(argv[1]) : 1 << 18;
+    const int repeat = argc > 2 ? std::stoi(argv[2]) : 5;
+    std::printf("%d matrices, %s, native lanes %d, single thread\n", n, sizeof(Scalar) == 4 ? "float" : "double", kSIMDLanes);
+
+    // Deformation gradients as they show up in a simulation: rotation times a moderate stretch, a few inverted
+    std::mt19937                           rng(7);
+    std::uniform_real_distribution<Scalar> u(-1, 1);
+    std::vector<Matrix3s>                  F(n);
+    for (int i = 0; i < n; ++i)
+    {
+        Matrix3s R = Eigen::AngleAxis<Scalar>(Scalar(3.14159) * u(rng), Vector3s(u(rng), u(rng), u(rng)).normalized())
+                         .toRotationMatrix();
+        Matrix3s S = Matrix3s::Identity() + Scalar(0.3) * Matrix3s::NullaryExpr([&]() { return u(rng); });
+        F[i]       = R * S;
+        if (i % 100 == 0)
+            F[i].col(0) *= -1;
+    }
+
+    std::vector<Matrix3s> reference(n);
+    double                s = BestOf(repeat, [&]() {
+        for (int i = 0; i < n; ++i)
+            reference[i] = EigenPolar(F[i]);
+    });
+    Report("Eigen JacobiSVD", n, s, F, reference, reference);
+
+    std::vector<Matrix3s> R;
+    s = RunLanes<1>(F, R, repeat);
+    Report("SVD3 scalar", n, s, F, R, reference);
+    s = RunLanes<4>(F, R, repeat);
+    Report("SVD3 x4", n, s, F, R, reference);
+    s = RunLanes<8>(F, R, repeat);
+    Report("SVD3 x8", n, s, F, R, reference);
+    s = RunLanes<16>(F, R, repeat);
+    Report("SVD3 x16", n, s, F, R, reference);
+
+    // AoS in/out including the SoA transposes, all threads
+    R.resize(n);
+    s = BestOf(repeat, [&]() { PolarBatch(F.data(), R.data(), n); });
+    Report("PolarBatch (omp)", n, s, F, R, reference);
+    return 0;
+}
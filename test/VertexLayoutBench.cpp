@@ -0,0 +1,113 @@
+// Per-vertex kernel throughput of the column-major Nx3 matrix vs. FS::VertexBuffer layouts.
+// USAGE: VertexLayoutBench [NUM_VERTICES] [REPEAT]
+#include "Core/VertexBuffer.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+
+using namespace FS;
+
+using ColMajorMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+static double BestOf(int repeat, const std::function<void()>& kernel)
+{
+    double best = 1e30;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        kernel();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+    }
+    return best;
+}
+
+static void Report(const char* kernel, const char* layout, Eigen::Index n, double seconds, Scalar checksum)
+{
+    std::printf("%-12s %-16s %10.1f Mvert/s  (%.3f ms, checksum %g)\n", kernel, layout, n / seconds * 1e-6, seconds * 1e3, double(checksum));
+}
+
+template<VertexLayout L>
+static void RunLayout(const char* name, const ColMajorMatrix& V0, const std::vector<int>& gather, int repeat)
+{
+    VertexBuffer<Scalar, L> V(V0);
+    const Matrix3s          R = Eigen::AngleAxis<Scalar>(Scalar(0.1), Vector3s::UnitY()).toRotationMatrix();
+    const Vector3s          t(Scalar(0.01), Scalar(0.02), Scalar(0.03));
+
+    double s = BestOf(repeat, [&]() {
+        V.forEachVertex([&](Eigen::Index, Scalar& x, Scalar& y, Scalar& z) {
+            Scalar nx = R(0, 0) * x + R(0, 1) * y + R(0, 2) * z + t(0);
+            Scalar ny = R(1, 0) * x + R(1, 1) * y + R(1, 2) * z + t(1);
+            Scalar nz = R(2, 0) * x + R(2, 1) * y + R(2, 2) * z + t(2);
+            x = nx, y = ny, z = nz;
+        });
+    });
+    Report("transform", name, V.rows(), s, V(0, 0));
+
+    Scalar sum = 0;
+    s          = BestOf(repeat, [&]() {
+        Scalar acc = 0;
+        V.forEachVertex([&](Eigen::Index, Scalar& x, Scalar& y, Scalar& z) { acc += x * x + y * y + z * z; });
+        sum = acc;
+    });
+    Report("norm2-sum", name, V.rows(), s, sum);
+
+    s = BestOf(repeat, [&]() {
+        Scalar acc = 0;
+        for (int i : gather)
+            acc += V(i, 0) + V(i, 1) + V(i, 2);
+        sum = acc;
+    });
+    Report("gather-xyz", name, static_cast<Eigen::Index>(gather.size()), s, sum);
+}
+
+static void RunColMajor(const ColMajorMatrix& V0, const std::vector<int>& gather, int repeat)
+{
+    ColMajorMatrix V = V0;
+    const Matrix3s R = Eigen::AngleAxis<Scalar>(Scalar(0.1), Vector3s::UnitY()).toRotationMatrix();
+    const Vector3s t(Scalar(0.01), Scalar(0.02), Scalar(0.03));
+
+    double s = BestOf(repeat, [&]() {
+        for (Eigen::Index i = 0; i < V.rows(); ++i)
+            V.row(i) = (R * V.row(i).transpose() + t).transpose();
+    });
+    Report("transform", "MatrixX col-major", V.rows(), s, V(0, 0));
+
+    Scalar sum = 0;
+    s          = BestOf(repeat, [&]() {
+        Scalar acc = 0;
+        for (Eigen::Index i = 0; i < V.rows(); ++i)
+            acc += V.row(i).squaredNorm();
+        sum = acc;
+    });
+    Report("norm2-sum", "MatrixX col-major", V.rows(), s, sum);
+
+    s = BestOf(repeat, [&]() {
+        Scalar acc = 0;
+        for (int i : gather)
+            acc += V(i, 0) + V(i, 1) + V(i, 2);
+        sum = acc;
+    });
+    Report("gather-xyz", "MatrixX col-major", static_cast<Eigen::Index>(gather.size()), s, sum);
+}
+
+int main(int argc, char** argv)
+{
+    Eigen::Index n      = argc > 1 ? std::stol(argv[1]) : (1 << 22);
+    int          repeat = argc > 2 ? std::stoi(argv[2]) : 20;
+    std::printf("%ld vertices, %s, best of %d\n", long(n), sizeof(Scalar) == 4 ? "float" : "double", repeat);
+
+    ColMajorMatrix V0 = ColMajorMatrix::Random(n, 3);
+    std::vector<int> gather(n);
+    std::mt19937     rng(42);
+    std::uniform_int_distribution<int> dist(0, static_cast<int>(n - 1));
+    for (int& i : gather)
+        i = dist(rng);
+
+    RunColMajor(V0, gather, repeat);
+    RunLayout<VertexLayout::AoS4>("AoS4", V0, gather, repeat);
+    RunLayout<VertexLayout::SoA8>("SoA8", V0, gather, repeat);
+    return 0;
+}